@@ -1,15 +1,84 @@
 #ifndef AI_H
 #define AI_H
 
+#include "book.h"
+#include "endgame.h"
 #include "game.h"
+#include "grid.h"
+#include "mcts.h"
+#include "rng.h"
+#include "search.h"
+#include "tablebase.h"
+#include "telemetry.h"
+#include "ttable.h"
+#include <stddef.h>
 
 typedef enum {
     AI_DIFFICULTY_RANDOM,
     AI_DIFFICULTY_EASY,
     AI_DIFFICULTY_MEDIUM,
-    AI_DIFFICULTY_HARD
+    AI_DIFFICULTY_HARD,
+    AI_DIFFICULTY_MCTS
 } AIDifficulty;
 
-void AI_MakeMove(Game *game, AIDifficulty difficulty);
+// Per-move thinking time for AI_DIFFICULTY_HARD.
+#define AI_HARD_TIME_MS 500
+
+// Per-move thinking time for AI_DIFFICULTY_MCTS.
+#define AI_MCTS_TIME_MS 500
+
+// Default transposition table size for each AIContext.
+#define AI_HASH_MB 16
+
+// Hard and MCTS play straight from the tablebase once no more than this many
+// edges are left on a board it covers.
+#define AI_TB_MAX_EDGES TABLEBASE_MAX_EDGES
+
+// Per-instance AI state. Each thread that runs AIs owns its own context, so
+// nothing here is shared or locked.
+typedef struct {
+    Rng rng;
+    TTable tt;              // allocated on the first search
+    int tt_rows, tt_cols;   // board size the table holds positions of
+    size_t hash_mb;
+    SearchLimits hard_limits;
+    SearchScratch scratch;  // Hard's move lists, reused from move to move
+    Mcts *mcts;             // created on the first MCTS move
+    int mcts_threads;       // 0 = one per CPU
+    MctsLimits mcts_limits;
+    int32_t stop;           // set from another thread to cut a search short
+    const Tablebase *tablebase; // shared and read-only, may be NULL
+    int tb_max_edges;
+    const Book *book;       // shared and read-only, may be NULL
+    Endgame endgame;        // chain/loop values, shared by Hard's searches
+#if TELEMETRY_ENABLED
+    TelemetryMove last_move;    // filled in by AI_ChooseMove
+#endif
+} AIContext;
+
+void AI_Init(AIContext *ai, uint64_t seed);
+void AI_Free(AIContext *ai);
+
+// Picks a move for `player` without playing it. Returns the edge index, or -1
+// if the board is full. The grid is only borrowed for search and is left as
+// it was found.
+int AI_ChooseMove(AIContext *ai, Grid *grid, int player, AIDifficulty difficulty);
+
+// Searches `player`'s position with no limit until AI_Stop, only to warm the
+// transposition table for the reply. Does nothing for levels other than Hard.
+void AI_Ponder(AIContext *ai, Grid *grid, int player, AIDifficulty difficulty);
+
+// Thread-safe: makes the search running on `ai` return as soon as possible.
+// The flag stays up until AI_ClearStop.
+void AI_Stop(AIContext *ai);
+void AI_ClearStop(AIContext *ai);
+
+// The Random/Easy/Medium heuristics on their own, for use as playout
+// policies. Any other level falls back to Medium.
+int AI_PolicyMove(Rng *rng, const Grid *grid, AIDifficulty level);
+
+// Plays one move for the current player and returns the number of boxes it
+// claimed; a non-zero result means the same player moves again.
+int AI_MakeMove(Game *game, AIDifficulty difficulty);
 
 #endif // AI_H
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef AI_WORKER_H
+#define AI_WORKER_H
+
+#include "ai.h"
+#include "grid.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    AI_JOB_NONE,
+    AI_JOB_MOVE,
+    AI_JOB_PONDER,
+} AIJobKind;
+
+// Runs an AIContext on a background thread so the caller never blocks on a
+// search. The caller hands over a copy of the board and polls a one-slot
+// mailbox for the answer. Every new request cancels the one in flight;
+// results of cancelled requests are dropped.
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;    // signalled when a result is posted
+    AIContext ai;           // used only by the worker thread
+
+    // Guarded by `lock`.
+    Grid pending;           // board of the latest request
+    int player;
+    AIDifficulty difficulty;
+    AIJobKind job;          // AI_JOB_NONE once the worker has taken it
+    uint32_t generation;    // bumped by every request and cancel
+    bool quit;
+    bool has_result;
+    int result;
+
+    Grid board;             // the worker's own copy while it searches
+    bool thinking;          // caller side: a move was requested, not yet polled
+} AIWorker;
+
+void AIWorker_Init(AIWorker *w, uint64_t seed);
+void AIWorker_Free(AIWorker *w);
+
+// Starts choosing a move for `player` on a snapshot of `grid`.
+void AIWorker_Think(AIWorker *w, const Grid *grid, int player, AIDifficulty difficulty);
+
+// Thinks on the opponent's time: searches `player`'s position until the next
+// request or cancel.
+void AIWorker_Ponder(AIWorker *w, const Grid *grid, int player, AIDifficulty difficulty);
+
+// Stops whatever the worker is doing and forgets any unread result.
+void AIWorker_Cancel(AIWorker *w);
+
+// Returns true once, with the chosen edge, when the last Think has finished.
+bool AIWorker_Poll(AIWorker *w, int *edge);
+
+// Like AIWorker_Poll, but waits up to `timeout_ms` for the result.
+bool AIWorker_Wait(AIWorker *w, int *edge, double timeout_ms);
+
+// True from AIWorker_Think until its result is polled or cancelled.
+bool AIWorker_IsThinking(const AIWorker *w);
+
+#endif // AI_WORKER_H
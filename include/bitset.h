@@ -0,0 +1,41 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Packed bit sets stored as arrays of 64-bit words, bit i lives in word i / 64.
+
+#define BITSET_WORDS(bits) (((bits) + 63) / 64)
+
+static inline bool Bitset_Test(const uint64_t *set, int i) {
+    return (set[i >> 6] >> (i & 63)) & 1;
+}
+
+static inline void Bitset_Set(uint64_t *set, int i) {
+    set[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+static inline void Bitset_Clear(uint64_t *set, int i) {
+    set[i >> 6] &= ~((uint64_t)1 << (i & 63));
+}
+
+// Mask of the valid bits in the last word of a set holding `bits` bits.
+static inline uint64_t Bitset_TailMask(int bits) {
+    int rem = bits & 63;
+    return rem ? (((uint64_t)1 << rem) - 1) : ~(uint64_t)0;
+}
+
+static inline int Bitset_Count(const uint64_t *set, int words) {
+    int n = 0;
+    for (int w = 0; w < words; w++) {
+        n += __builtin_popcountll(set[w]);
+    }
+    return n;
+}
+
+static inline int Bitset_Ctz(uint64_t word) {
+    return __builtin_ctzll(word);
+}
+
+#endif // BITSET_H
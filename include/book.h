@@ -0,0 +1,78 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include "grid.h"
+#include "rng.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Opening book for one board size: the positions of the first `plies` moves,
+// up to symmetry, each with a few good moves and their weights. Entries are
+// keyed by Grid_canonical_hash and their moves stored as seen on that
+// canonical image, the way the transposition table stores them.
+//
+// Records are fixed-size and sorted by key. The index gives, for every value
+// of the key's top index_bits bits, the first record with that prefix; with
+// about one record per prefix a probe reads one index pair and a record or
+// two.
+//
+// File layout, native endian:
+//   BookHeader
+//   uint32_t index[(1 << index_bits) + 1]
+//   BookEntry[num_entries], 8-byte aligned
+#define BOOK_MAGIC "DABOBOOK"
+#define BOOK_VERSION 2
+#define BOOK_PATH "dab.book"
+
+#define BOOK_MOVES 4
+#define BOOK_MAX_INDEX_BITS 24
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    int32_t rows;
+    int32_t cols;
+    int32_t plies;          // positions with fewer drawn edges are covered
+    uint32_t index_bits;    // 1 to BOOK_MAX_INDEX_BITS
+    uint32_t reserved;
+    uint64_t num_entries;
+} BookHeader;
+
+typedef struct {
+    uint64_t key;
+    uint16_t moves[BOOK_MOVES];     // canonical-image edges, best first
+    uint16_t weights[BOOK_MOVES];   // 0 past the last move
+} BookEntry;
+
+// A read-only mapping of a book file.
+typedef struct {
+    void *map;
+    size_t map_size;
+    const BookHeader *header;
+    const uint32_t *index;
+    const BookEntry *entries;
+} Book;
+
+bool Book_Open(Book *book, const char *path);
+void Book_Close(Book *book);
+
+// Offset of the entries from the start of a file with this header.
+static inline uint64_t Book_EntriesOffset(const BookHeader *header) {
+    uint64_t offset = sizeof(BookHeader) + (((uint64_t)1 << header->index_bits) + 1) * sizeof(uint32_t);
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+static inline uint32_t Book_Bucket(uint64_t key, uint32_t index_bits) {
+    return (uint32_t)(key >> (64 - index_bits));
+}
+
+// The entry for `g`, or NULL if the book does not cover it. `sym` receives
+// the symmetry that maps `g` onto the entry's image.
+const BookEntry *Book_Find(const Book *book, const Grid *g, int *sym);
+
+// A book move for `g`, picked at random in proportion to the weights, or -1
+// when `g` is out of book.
+int Book_Move(const Book *book, const Grid *g, Rng *rng);
+
+#endif // BOOK_H
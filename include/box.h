@@ -8,5 +8,9 @@ bool Box_IsComplete(const Grid *g, int row, int col);
 void Box_Claim(Grid *g, int row, int col, int player_id);
 int Box_CheckAndClaimAfterHorizontal(Grid *g, int edge_r, int edge_c, int player_id);
 int Box_CheckAndClaimAfterVertical(Grid *g, int edge_r, int edge_c, int player_id);
+int Box_CheckAndClaimAfterEdge(Grid *g, int edge, int player_id);
+int Box_Sides(const Grid *g, int row, int col);
+int Box_CapturesFor(const Grid *g, int edge);
+void Box_UnclaimAfterEdge(Grid *g, int edge);
 
-#endif // BOX_H
\ No newline at end of file
+#endif // BOX_H
@@ -0,0 +1,58 @@
+#ifndef CHAIN_H
+#define CHAIN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct Grid Grid;
+
+// Decomposition of the board into chains and loops: connected runs of boxes
+// with exactly two sides drawn, linked through their undrawn shared edges. A
+// run that closes on itself is a loop; anything else is a chain whose ends
+// lead to the border, to a junction box or to a capturable box.
+//
+// Once attached to a grid, the set is updated from inside Grid_set_edge and
+// Grid_clear_edge by re-walking only the runs that touch the edge.
+#define CHAIN_LONG 3
+
+typedef struct ChainSet {
+    int num_boxes;
+    int *chain_of;          // per box: run index, or -1
+    int *next;              // per box: next member of its run (circular)
+    int *head;              // per run: one member
+    int *length;            // per run
+    bool *loop;             // per run
+    int *free_runs;
+    int num_free;
+    int *chain_hist;        // chains / loops of each length
+    int *loop_hist;
+    int num_chains;
+    int num_long_chains;
+    int num_loops;
+    int shortest_chain;     // 0 when there are none
+    int shortest_loop;
+    int run_boxes;          // boxes in all runs together
+    uint64_t shape_hash;    // sum of Chains_ShapeKey over the runs
+    int *pending;           // scratch for updates
+    int *queue;
+} ChainSet;
+
+void Chains_Attach(ChainSet *cs, Grid *g);
+void Chains_Detach(ChainSet *cs, Grid *g);
+void Chains_EdgeChanged(ChainSet *cs, const Grid *g, int edge);
+
+// Key of one run's shape. Keys are summed, so the multiset of chain and loop
+// lengths has one hash whatever the order the runs appear in.
+static inline uint64_t Chains_ShapeKey(int length, bool loop) {
+    uint64_t z = (uint64_t)(2 * length + loop) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Parity of the number of long chains (length >= CHAIN_LONG).
+static inline int Chains_Parity(const ChainSet *cs) {
+    return cs->num_long_chains & 1;
+}
+
+#endif // CHAIN_H
@@ -0,0 +1,27 @@
+#ifndef CLASSIFY_H
+#define CLASSIFY_H
+
+#include "grid.h"
+#include <stdbool.h>
+
+// Bulk recomputation of a grid's derived state from its edge set: per-box
+// side counts, then every undrawn edge's class (capture when a box beside it
+// has three sides, safe when both have at most one). Grid_set_edge keeps all
+// of this up to date one edge at a time; these kernels are for loading a
+// whole position at once.
+//
+// Boards are processed a row of boxes at a time on byte lanes. The widest
+// implementation the CPU supports (AVX2, SSE2, else portable C) is picked on
+// first use.
+
+// Rewrites g->sides, capture_moves, safe_moves and the move counts.
+void Classify_Grid(Grid *g);
+
+// Name of the implementation in use: "avx2", "sse2" or "scalar".
+const char *Classify_Impl(void);
+
+// Switches to the named implementation, for benchmarks and cross-checks.
+// Fails if it is unknown or the CPU lacks it.
+bool Classify_Use(const char *name);
+
+#endif // CLASSIFY_H
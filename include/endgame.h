@@ -0,0 +1,53 @@
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include "chain.h"
+#include "grid.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Exact values for simple loony endgames: every unclaimed box has two sides
+// drawn, so the board is a sum of independent chains (both ends on the
+// border) and loops. The side to move must open one; the opponent then takes
+// it all and moves next, or keeps control by declining the last two boxes
+// of a chain of three or more (four of a loop). With f(S) the value of the
+// remaining runs S for the side to move,
+//   f(S) = max over runs c of -max(n + f(S - c), n - 4 - f(S - c))
+// for a chain of n boxes (the second term only when n >= 3; a two-chain is
+// opened in the middle so it cannot be declined) and n - 8 in place of
+// n - 4 for a loop. A position's value depends only on the multiset of run
+// shapes, its canonical form, so values are cached under the ChainSet's
+// shape hash and shared between every position with the same runs.
+//
+// Only such pure chain-and-loop positions are solved. A board that splits
+// into independent regions of any other kind is left to the search: the box
+// margins of general regions do not add up, and their nimstring values only
+// tell who keeps control, not by how much.
+typedef struct {
+    uint64_t *keys;         // shape hashes, 0 for an empty slot
+    int32_t *values;
+    size_t capacity;        // power of two, 0 until first used
+    size_t count;
+    uint64_t probes;
+    uint64_t hits;
+} Endgame;
+
+void Endgame_Init(Endgame *eg);
+void Endgame_Free(Endgame *eg);
+
+// True if `g`, which must have chains attached, is a simple loony endgame.
+static inline bool Endgame_IsSimple(const Grid *g) {
+    return g->chains->run_boxes == Grid_boxes_left(g);
+}
+
+// Value of a simple endgame for the side to move (its boxes from here on
+// minus the opponent's), or false if the position is not one. `g` must have
+// chains attached.
+bool Endgame_Value(Endgame *eg, const Grid *g, int *value);
+
+// An optimal move in a simple endgame, or -1 if `g` is not one. Chains are
+// attached for the call if `g` has none. `value` may be NULL.
+int Endgame_BestMove(Endgame *eg, Grid *g, int *value);
+
+#endif // ENDGAME_H
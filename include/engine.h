@@ -0,0 +1,37 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <stdio.h>
+
+// Line-based engine protocol, in the spirit of UCI, for driving the AI from
+// another process. One command per line, words separated by blanks; edges
+// are Grid edge indices. The process keeps its transposition table, MCTS
+// thread pool, tablebase and book between games.
+//
+//   dab                        -> id ..., option ..., dabok
+//   isready                    -> readyok
+//   setoption name N value V   Hash (MB), Threads (MCTS), Tablebase (path),
+//                              Book (path), Level (random|easy|medium|hard|mcts)
+//   newgame                    forget everything learned about past games
+//   size ROWS COLS             empty board of that size
+//   position startpos [moves E...]
+//   position edges E... [score S0 S1] [turn P] [moves E...]
+//                              load drawn edges in bulk, P to move (0 or 1);
+//                              the score, as in dab-solve's input, is needed
+//                              once any box is complete
+//   play E                     one more move on the current position
+//   go [depth D] [movetime MS] [nodes N] [level L] [infinite]
+//                              -> info ... lines, then bestmove E
+//   stop                       end the search now; its bestmove follows
+//   d                          -> the position as info string lines
+//   quit
+//
+// A search runs on its own thread, so stop and isready are answered while
+// it thinks. Any other command that changes the position stops it first.
+// Problems are reported as "info string error: ...".
+
+// Serves commands from `in` until quit or end of input. Returns the exit
+// status for the process.
+int Engine_Run(FILE *in, FILE *out);
+
+#endif // ENGINE_H
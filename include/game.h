@@ -2,6 +2,7 @@
 #define GAME_H
 
 #include "grid.h"
+#include "movestack.h"
 #include "player.h"
 
 typedef enum {
@@ -17,11 +18,17 @@ typedef enum {
     STATE_GAME_OVER,
 } GameState;
 
+#define GAME_DEFAULT_SIZE 5
+// Largest rows or cols; keeps box counts inside the 16-bit TT values.
+#define GAME_MAX_SIZE 128
+
 // Full definition of Game struct
 typedef struct Game {
     GameMode mode;
     GameState state;
     Grid grid;
+    MoveStack history;      // moves on `grid`, for undo and redo
+    int rows, cols;         // size of the next board; grid keeps its own
     int current_player;
     int scores[2];
     bool extra_turn;
@@ -32,9 +39,21 @@ typedef struct Game {
 
 extern Game game;
 
-void InitGame(GameMode mode);
+void InitGame(GameMode mode, int rows, int cols);
+void ShowMenu(void);
+void CloseGame(void);
+// Appends every finished game to the record file at `path` (see record.h).
+bool StartRecording(const char *path);
 void UpdateGame(void);
 void DrawGame(void);
+// False while the game moves on by itself (an AI is to move), so the main
+// loop can sleep until input arrives whenever it is true.
+bool GameIsIdle(void);
+// Whether a frame drawn now would differ from the last one: the game, the
+// hovered edge or an animation changed.
+bool GameNeedsRedraw(void);
+// Lets AI vs AI games play several moves per drawn frame.
+void SetTurboMode(bool on);
 void ResetGrid(void);
 
 #endif // GAME_H
\ No newline at end of file
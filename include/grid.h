@@ -2,21 +2,140 @@
 #define GRID_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "bitset.h"
+
+// Edges share one index space: horizontal edges come first (r * cols + c),
+// followed by vertical edges (num_h + r * (cols + 1) + c). Box ownership is
+// kept as one claimed-by mask per player, indexed r * cols + c.
+//
+// sides[b] counts the drawn sides of box b. Every undrawn edge is in exactly
+// one move class: capture_moves (completes a box), safe_moves (every box it
+// touches still has at most one side drawn) or, implicitly, the rest, which
+// are sacrifices that hand the opponent a third side. All of these, and the
+// per-class counts, are kept up to date by Grid_set_edge / Grid_clear_edge.
+//
+// claimed[p] and claimed_total count claimed boxes and are maintained by the
+// Box_* claim functions, so game-over and score checks are constant time.
+//
+// chains, when non-NULL, is a chain/loop decomposition kept in step with the
+// edges (see chain.h).
+//
+// hash[s] is the Zobrist key of the edge set seen through board symmetry s,
+// updated whenever an edge is drawn or cleared. Keys depend on the board size,
+// so equal edge sets on different boards hash apart. Symmetries 0-3 (identity,
+// half turn and the two mirrors) exist on every board; 4-7 (the diagonal
+// mirrors and quarter turns) only on square ones.
+//
+// Every array lives in one allocation, `block`: the position first
+// (state_size bytes), then the per-size lookup tables.
+#define GRID_MAX_SYMMETRIES 8
 
 typedef struct Grid {
     int rows;
     int cols;
-    bool *h_edges;
-    bool *v_edges;
-    int *owners;
+    int num_h;
+    int num_edges;
+    int num_boxes;
+    int edge_words;
+    int box_words;
+    uint64_t *edges;
+    uint64_t *owned[2];
+    int claimed[2];
+    int claimed_total;
+    uint8_t *sides;
+    uint64_t *capture_moves;
+    uint64_t *safe_moves;
+    int num_open;
+    int num_capture;
+    int num_safe;
+    int *edge_boxes;        // 2 * num_edges, boxes on either side or -1
+    int num_syms;
+    uint64_t hash[GRID_MAX_SYMMETRIES];
+    int *sym_edges;         // num_syms * num_edges, image of each edge
+    uint64_t *sym_keys;     // num_syms * num_edges, Zobrist key of that image
+    struct ChainSet *chains;
+    const struct GridKernels *kernels;  // see gridkernels.h
+    void *block;
+    size_t state_size;
+    size_t block_size;
 } Grid;
 
+typedef enum {
+    MOVES_OPEN,
+    MOVES_CAPTURE,
+    MOVES_SAFE,
+    MOVES_SACRIFICE
+} MoveClass;
+
 void Grid_Init(Grid *g, int rows, int cols);
 void Grid_Free(Grid *g);
+// A new grid holding the position of `src`, made with one allocation and
+// one memcpy. Chains are not cloned.
+void Grid_Clone(Grid *dst, const Grid *src);
+void Grid_CopyInto(Grid *dst, const Grid *src);
+// Replaces the position with the edge set `edges` in one pass (see
+// classify.h). Complete boxes marked in `owned1` go to player 1 and the rest
+// to player 0; `owned1` may be NULL. No chains may be attached.
+void Grid_SetPosition(Grid *g, const uint64_t *edges, const uint64_t *owned1);
 int Grid_index_h(const Grid *g, int r, int c);
 int Grid_index_v(const Grid *g, int r, int c);
 bool Grid_set_horizontal(Grid *g, int r, int c);
 bool Grid_set_vertical(Grid *g, int r, int c);
+bool Grid_set_edge(Grid *g, int edge);
+void Grid_clear_edge(Grid *g, int edge);
+void Grid_edge_coords(const Grid *g, int edge, bool *horizontal, int *r, int *c);
 int Grid_claimed_box(const Grid *g, int r, int c);
+int Grid_count_moves(const Grid *g, MoveClass cls);
+int Grid_nth_move(const Grid *g, MoveClass cls, int k);
+uint64_t Grid_canonical_hash(const Grid *g, int *sym);
+int Grid_sym_inverse(int sym);
+
+// Image of `edge` under symmetry `sym`.
+static inline int Grid_sym_edge(const Grid *g, int sym, int edge) {
+    return g->sym_edges[sym * g->num_edges + edge];
+}
+
+static inline bool Grid_has_edge(const Grid *g, int edge) {
+    return Bitset_Test(g->edges, edge);
+}
+
+static inline bool Grid_has_h(const Grid *g, int r, int c) {
+    return Bitset_Test(g->edges, r * g->cols + c);
+}
+
+static inline bool Grid_has_v(const Grid *g, int r, int c) {
+    return Bitset_Test(g->edges, g->num_h + r * (g->cols + 1) + c);
+}
+
+// Boxes on either side of an edge (top/left first); -1 past the border.
+static inline const int *Grid_edge_boxes(const Grid *g, int edge) {
+    return g->edge_boxes + 2 * edge;
+}
+
+// Word `w` of the set of undrawn edges in class `cls`.
+static inline uint64_t Grid_moves_word(const Grid *g, MoveClass cls, int w) {
+    uint64_t open = ~g->edges[w];
+    if (w == g->edge_words - 1) open &= Bitset_TailMask(g->num_edges);
+    switch (cls) {
+        case MOVES_CAPTURE: return g->capture_moves[w];
+        case MOVES_SAFE: return g->safe_moves[w];
+        case MOVES_SACRIFICE: return open & ~g->capture_moves[w] & ~g->safe_moves[w];
+        default: return open;
+    }
+}
+
+static inline int Grid_boxes_left(const Grid *g) {
+    return g->num_boxes - g->claimed_total;
+}
+
+// Returns the owning player of box (r, c), or -1 if it is unclaimed.
+static inline int Grid_box_owner(const Grid *g, int r, int c) {
+    int b = r * g->cols + c;
+    if (Bitset_Test(g->owned[0], b)) return 0;
+    if (Bitset_Test(g->owned[1], b)) return 1;
+    return -1;
+}
 
-#endif // GRID_H
\ No newline at end of file
+#endif // GRID_H
@@ -0,0 +1,28 @@
+#ifndef GRIDKERNELS_H
+#define GRIDKERNELS_H
+
+#include "grid.h"
+
+// The rules kernels the searches spend their time in, compiled once per
+// common board size with the dimensions as constants (index math folds,
+// word and symmetry loops unroll) and once generically. Grid_Init binds
+// g->kernels to the table for its size.
+typedef struct GridKernels {
+    int rows;               // 0 for the generic table
+    int cols;
+    // Draws an undrawn edge and claims the boxes it completes; returns them.
+    int (*play)(Grid *g, int edge, int player);
+    // Undoes the latest play of `edge`.
+    void (*unplay)(Grid *g, int edge);
+    // Appends the edges of class `cls`, except `skip`, to `moves`; returns
+    // how many were written.
+    int (*collect)(const Grid *g, MoveClass cls, int *moves, int skip);
+    // Boxes the side to move could complete right now, counting a box
+    // reached by two capture edges once per edge.
+    int (*capturable)(const Grid *g);
+} GridKernels;
+
+// Specialised table for rows x cols, or the generic one.
+const GridKernels *GridKernels_For(int rows, int cols);
+
+#endif // GRIDKERNELS_H
@@ -0,0 +1,66 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include "grid.h"
+#include "movestack.h"
+#include "threadpool.h"
+#include <stdint.h>
+
+// Zero means "no limit" for time_ms and max_playouts; at least one should be
+// set. rollout_level is the AIDifficulty (random, easy or medium) used as the
+// playout policy. `stop`, if not NULL, ends the search once it is set.
+typedef struct {
+    int time_ms;
+    int64_t max_playouts;
+    int rollout_level;
+    double exploration;
+    const int32_t *stop;
+} MctsLimits;
+
+typedef struct {
+    int move;               // edge index, -1 if the board is full
+    int64_t playouts;
+    double elapsed_ms;
+    double playouts_per_sec;
+    double win_rate;        // expected reward of the chosen move, 0..1
+    int tree_nodes;
+} MctsResult;
+
+// Visits and values are updated with atomics only. Children of a node sit
+// in one contiguous block claimed from the shared pool by whichever thread
+// wins the expansion.
+typedef struct {
+    int32_t move;
+    int32_t first_child;
+    int32_t num_children;
+    int32_t state;          // MCTS_LEAF, MCTS_EXPANDING, MCTS_EXPANDED
+    int32_t player;         // who played `move`
+    int32_t visits;         // includes in-flight virtual losses
+    int64_t value;          // summed playout rewards for `player`
+} MctsNode;
+
+// A worker's private board and move buffers, kept between searches and only
+// rebuilt when the board size changes.
+typedef struct {
+    Grid board;
+    bool has_board;
+    int *path;              // node indices from the root, one per edge + 1
+    MoveStack played;       // moves of the current playout
+} MctsWorker;
+
+// Tree-parallel UCT on a persistent thread pool. The node pool is reused
+// from search to search.
+typedef struct Mcts {
+    ThreadPool pool;
+    MctsWorker *workers;
+    MctsNode *nodes;
+    int capacity;
+} Mcts;
+
+#define MCTS_DEFAULT_NODES (1 << 20)
+
+void Mcts_Init(Mcts *mcts, int threads, int capacity);
+void Mcts_Free(Mcts *mcts);
+MctsResult Mcts_Search(Mcts *mcts, const Grid *g, int player, const MctsLimits *limits, uint64_t seed);
+
+#endif // MCTS_H
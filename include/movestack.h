@@ -0,0 +1,61 @@
+#ifndef MOVESTACK_H
+#define MOVESTACK_H
+
+#include "box.h"
+#include "grid.h"
+#include "gridkernels.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+// Make and unmake. A move draws its edge and claims the boxes it completes;
+// unmaking the latest move clears them again, since every box next to the
+// edge that is complete was completed by it. Both are constant time, so
+// searches explore a single board in place. They run the board's
+// size-specialised kernels (gridkernels.h).
+static inline int Move_Play(Grid *g, int edge, int player) {
+    return g->kernels->play(g, edge, player);
+}
+
+static inline void Move_Unplay(Grid *g, int edge) {
+    g->kernels->unplay(g, edge);
+}
+
+typedef struct {
+    int edge;
+    int8_t player;          // side that drew the edge
+    int8_t claimed;         // boxes it completed
+} MoveRecord;
+
+// Side to move after `m`: completing a box earns another move.
+static inline int MoveRecord_NextPlayer(const MoveRecord *m) {
+    return m->claimed ? m->player : 1 - m->player;
+}
+
+// The moves played on a board, with the undone ones kept above `count` for
+// redo until a new move replaces them.
+typedef struct {
+    MoveRecord *moves;
+    int count;              // moves currently on the board
+    int top;                // count plus the moves that can be redone
+    int capacity;           // the board's edge count
+} MoveStack;
+
+void MoveStack_Init(MoveStack *s, int capacity);
+void MoveStack_Free(MoveStack *s);
+// Forgets every move without touching the board.
+void MoveStack_Clear(MoveStack *s);
+
+// Plays `edge` for `player` and pushes it, dropping the redo moves. Returns
+// the boxes claimed, or -1 if the edge is already drawn.
+int MoveStack_Make(MoveStack *s, Grid *g, int edge, int player);
+
+// Take back the latest move or replay the latest undone one. Return the
+// move, or NULL if there is none.
+const MoveRecord *MoveStack_Undo(MoveStack *s, Grid *g);
+const MoveRecord *MoveStack_Redo(MoveStack *s, Grid *g);
+
+// Undoes moves until `count` are left, dropping them rather than keeping
+// them for redo.
+void MoveStack_Rewind(MoveStack *s, Grid *g, int count);
+
+#endif // MOVESTACK_H
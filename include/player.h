@@ -1,7 +1,7 @@
 #ifndef PLAYER_H
 #define PLAYER_H
 
-#include "raylib.h"
+#include <stdbool.h>
 
 // Forward declarations
 typedef struct Game Game;
@@ -9,7 +9,6 @@ typedef struct Grid Grid;
 
 typedef struct {
     int id;
-    Color color;
     int score;
     bool is_ai;
 } Player;
@@ -18,6 +17,7 @@ void Players_Init(Game *game);
 void Player_Switch(Game *game);
 bool Player_ShouldSwitch(int claimed);
 bool Game_IsOver(const Grid *grid);
+void Players_SyncScores(Game *game);
 int Game_GetWinner(const int scores[2]);
 
 #endif // PLAYER_H
\ No newline at end of file
@@ -0,0 +1,113 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "grid.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Binary game records. A file is a RecordHeader followed by games back to
+// back, each one:
+//   varint length           bytes of the rest of the game
+//   varint rows, cols
+//   varint num_moves
+//   varint edge[num_moves]  Grid edge indices in play order
+// The side to move is implied: it passes after every move that claims no
+// box. The length prefix lets a reader hop from game to game without
+// decoding moves, and a game cut short by a crash is ignored.
+#define RECORD_MAGIC "DABGAMES"
+#define RECORD_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+} RecordHeader;
+
+// Moves of one game being played, encoded as they are made.
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    int rows;
+    int cols;
+    int num_moves;
+} RecordBuffer;
+
+void RecordBuffer_Init(RecordBuffer *b);
+void RecordBuffer_Free(RecordBuffer *b);
+// Drops any moves and starts a game on a rows x cols board.
+void RecordBuffer_Begin(RecordBuffer *b, int rows, int cols);
+void RecordBuffer_Move(RecordBuffer *b, int edge);
+
+// Appends finished games to a file; safe to share between threads.
+typedef struct {
+    FILE *file;
+    pthread_mutex_t lock;
+    uint64_t games;         // appended since open
+} RecordWriter;
+
+// Opens `path` for appending, writing the header if the file is new and
+// cutting off a last game left incomplete by a crash. Fails if the file
+// exists but is not a record file.
+bool RecordWriter_Open(RecordWriter *w, const char *path);
+bool RecordWriter_Append(RecordWriter *w, const RecordBuffer *b);
+void RecordWriter_Flush(RecordWriter *w);
+bool RecordWriter_Close(RecordWriter *w);
+
+// A read-only mapping of a record file with the offset of every game.
+typedef struct {
+    void *map;
+    size_t map_size;
+    uint64_t *offsets;      // start of each game's length varint
+    uint64_t num_games;
+} RecordReader;
+
+// One game inside a mapped file; moves are decoded by RecordGame_Next.
+typedef struct {
+    int rows;
+    int cols;
+    int num_moves;
+    const uint8_t *next;
+    const uint8_t *end;
+} RecordGame;
+
+bool RecordReader_Open(RecordReader *r, const char *path);
+void RecordReader_Close(RecordReader *r);
+bool RecordReader_Game(const RecordReader *r, uint64_t index, RecordGame *game);
+
+// Next edge of the game, or -1 at its end or on a corrupt varint.
+int RecordGame_Next(RecordGame *game);
+
+// Plays the game onto `g`, an empty board of the game's size. Returns false
+// if a move is corrupt or illegal; g->claimed then holds the score so far.
+bool Record_Replay(RecordGame *game, Grid *g);
+
+// LEB128: seven bits per byte, low bits first, high bit set on all but the
+// last byte.
+static inline size_t Record_PutVarint(uint8_t *out, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static inline bool Record_GetVarint(const uint8_t **p, const uint8_t *end, uint64_t *value) {
+    uint64_t v = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7) {
+        uint8_t byte = *(*p)++;
+        v |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // RECORD_H
@@ -0,0 +1,17 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// xoshiro256** generator. Each thread or AI instance owns one, so results
+// are reproducible from the seed and need no locking.
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+void Rng_Seed(Rng *rng, uint64_t seed);
+uint64_t Rng_Next(Rng *rng);
+// Uniform integer in [0, n).
+int Rng_Range(Rng *rng, int n);
+
+#endif // RNG_H
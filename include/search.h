@@ -0,0 +1,52 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "endgame.h"
+#include "grid.h"
+#include "ttable.h"
+#include <stdint.h>
+
+typedef struct SearchResult SearchResult;
+
+// Called after every completed iteration of a search, on its thread.
+typedef void (*SearchInfoFn)(void *arg, const SearchResult *result);
+
+// Zero means "no limit" for every numeric field. `stop`, if not NULL, is
+// polled with the clock and ends the search once another thread sets it.
+// `info`, if not NULL, reports progress. `endgame`, if not NULL, values
+// simple loony endgames exactly wherever the search meets one.
+typedef struct {
+    int max_depth;
+    int time_ms;
+    int64_t max_nodes;
+    const int32_t *stop;
+    SearchInfoFn info;
+    void *info_arg;
+    Endgame *endgame;
+} SearchLimits;
+
+// Move lists for each ply, grown on demand and kept between searches, so
+// searching the same board again allocates nothing. Zero-initialise before
+// the first search.
+typedef struct {
+    int **plies;        // one list of `width` edges per ply, NULL until used
+    int num_plies;
+    int width;
+} SearchScratch;
+
+struct SearchResult {
+    int move;           // edge index, -1 if the board is full
+    int score;          // boxes still to come for the side to move, minus the opponent's
+    int depth;          // deepest fully searched iteration
+    int64_t nodes;
+    double elapsed_ms;
+};
+
+// Iterative-deepening negamax with alpha-beta pruning. The grid is played on
+// in place and restored before returning. `tt` may be NULL to search without
+// a transposition table, and `scratch` NULL to use a temporary one.
+SearchResult Search_BestMove(Grid *g, int player, const SearchLimits *limits, TTable *tt,
+                             SearchScratch *scratch);
+void Search_FreeScratch(SearchScratch *scratch);
+
+#endif // SEARCH_H
@@ -0,0 +1,59 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include "grid.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Exact values of every position on small boards, indexed by the drawn-edge
+// set itself: bit i of the index is edge i in Grid order. Entry values are
+// the boxes still to come for the side to move minus the opponent's; on a
+// given board they depend only on the drawn edges.
+//
+// File layout, native endian:
+//   TablebaseHeader
+//   TablebaseDir[num_tables]
+//   int8_t values[1 << num_edges] per table, at dir.offset
+#define TABLEBASE_MAGIC "DABTBASE"
+#define TABLEBASE_VERSION 1
+#define TABLEBASE_PATH "dab.tb"
+
+// Boards with more edges than this are never tabulated (3x3 has 24).
+#define TABLEBASE_MAX_EDGES 24
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_tables;
+} TablebaseHeader;
+
+typedef struct {
+    int32_t rows;
+    int32_t cols;
+    uint64_t offset;        // from the start of the file
+    uint64_t size;          // bytes, 1 << num_edges
+} TablebaseDir;
+
+// A read-only mapping of a tablebase file; pages load on first probe.
+typedef struct {
+    void *map;
+    size_t map_size;
+    const TablebaseDir *dir;
+    int num_tables;
+} Tablebase;
+
+bool Tablebase_Open(Tablebase *tb, const char *path);
+void Tablebase_Close(Tablebase *tb);
+
+// The table for a rows x cols board, or NULL.
+const int8_t *Tablebase_Find(const Tablebase *tb, int rows, int cols);
+
+// Exact value of `g` for the side to move. False if no table covers it.
+bool Tablebase_Value(const Tablebase *tb, const Grid *g, int *value);
+
+// A best move for the side to move, or -1 if no table covers the board or it
+// is full.
+int Tablebase_BestMove(const Tablebase *tb, const Grid *g);
+
+#endif // TABLEBASE_H
@@ -0,0 +1,81 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Counters for AI moves and frame times, built only with -DDAB_TELEMETRY
+// (make TELEMETRY=1, the default). Without it the types below still exist
+// but nothing is recorded: every call site sits behind TELEMETRY_ENABLED or
+// one of the TELEMETRY_* macros, which expand to nothing.
+#ifdef DAB_TELEMETRY
+#define TELEMETRY_ENABLED 1
+#else
+#define TELEMETRY_ENABLED 0
+#endif
+
+// Frame-time buckets: bucket i < TELEMETRY_BUCKETS - 1 holds times below
+// TELEMETRY_BUCKET0_MS << i, the last one everything slower.
+#define TELEMETRY_BUCKETS 12
+#define TELEMETRY_BUCKET0_MS 0.25
+
+// Frames per "frames" record written to the sink.
+#define TELEMETRY_FRAME_WINDOW 60
+
+typedef struct {
+    int difficulty;         // AIDifficulty
+    double ms;
+    int64_t nodes;          // Hard: search nodes; MCTS: playouts
+    int depth;              // Hard: deepest finished iteration
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+    int tree_nodes;         // MCTS
+    bool book;              // answered from the opening book
+    bool tablebase;         // answered from the tablebase
+    bool endgame;           // answered by the chain/loop solver
+} TelemetryMove;
+
+typedef struct {
+    uint64_t counts[TELEMETRY_BUCKETS];
+    uint64_t samples;
+    double total_ms;
+    double max_ms;
+} TelemetryHistogram;
+
+typedef struct {
+    TelemetryMove last_move;
+    uint64_t moves;
+    double move_ms;         // summed over all moves
+    int64_t nodes;
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+    TelemetryHistogram update;
+    TelemetryHistogram draw;
+} TelemetryStats;
+
+#if TELEMETRY_ENABLED
+
+// Appends JSON lines to `path`: one per AI move, one per frame window.
+bool Telemetry_OpenSink(const char *path);
+void Telemetry_Close(void);
+
+// Thread-safe; moves come from AI worker threads and are counted per thread,
+// so recording one only takes a lock when a sink is open.
+void Telemetry_RecordMove(const TelemetryMove *m);
+void Telemetry_RecordFrame(double update_ms, double draw_ms);
+void Telemetry_Snapshot(TelemetryStats *out);
+
+#define TELEMETRY_RECORD_MOVE(m) Telemetry_RecordMove(m)
+#define TELEMETRY_RECORD_FRAME(update_ms, draw_ms) Telemetry_RecordFrame(update_ms, draw_ms)
+
+#else
+
+#define TELEMETRY_RECORD_MOVE(m) ((void)0)
+#define TELEMETRY_RECORD_FRAME(update_ms, draw_ms) ((void)0)
+
+#endif
+
+// Upper bound of histogram bucket `i` in ms; infinite for the last.
+double Telemetry_BucketLimitMs(int i);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,31 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+typedef void (*ThreadPoolFn)(void *arg, int worker);
+
+// Fixed set of worker threads that sleep between jobs. A job runs the same
+// function once on every worker.
+typedef struct {
+    int num_threads;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    ThreadPoolFn fn;
+    void *arg;
+    unsigned generation;
+    int running;
+    bool quit;
+} ThreadPool;
+
+// threads <= 0 means one per online CPU.
+void ThreadPool_Init(ThreadPool *pool, int threads);
+void ThreadPool_Free(ThreadPool *pool);
+// Runs fn(arg, i) on worker i for every worker and waits for all of them.
+void ThreadPool_Run(ThreadPool *pool, ThreadPoolFn fn, void *arg);
+int ThreadPool_DefaultThreads(void);
+
+#endif // THREADPOOL_H
@@ -0,0 +1,10 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+// Monotonic clock in nanoseconds.
+uint64_t Timer_NowNs(void);
+double Timer_ElapsedMs(uint64_t start_ns);
+
+#endif // TIMER_H
@@ -0,0 +1,47 @@
+#ifndef TTABLE_H
+#define TTABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    TT_EMPTY,
+    TT_EXACT,
+    TT_LOWER,
+    TT_UPPER
+} TTBound;
+
+// 16 bytes; four of them fill a 64-byte bucket.
+typedef struct {
+    uint64_t key;
+    int32_t move;
+    int16_t value;
+    uint8_t depth;
+    uint8_t bound;
+} TTEntry;
+
+#define TT_BUCKET_SIZE 4
+
+typedef struct {
+    TTEntry slots[TT_BUCKET_SIZE];
+} TTBucket;
+
+// Fixed-size table of buckets indexed by the low key bits. Within a bucket a
+// new position replaces the shallowest entry.
+typedef struct {
+    TTBucket *buckets;
+    size_t num_buckets;     // power of two
+    uint64_t probes;
+    uint64_t hits;
+    uint64_t stores;
+    uint64_t collisions;    // stores that evicted a different position
+} TTable;
+
+bool TT_Init(TTable *tt, size_t megabytes);
+void TT_Free(TTable *tt);
+void TT_Clear(TTable *tt);
+const TTEntry *TT_Probe(TTable *tt, uint64_t key);
+void TT_Store(TTable *tt, uint64_t key, int depth, int value, TTBound bound, int move);
+
+#endif // TTABLE_H
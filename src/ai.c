@@ -1,233 +1,227 @@
 #include "ai.h"
-#include "box.h"
+#include "movestack.h"
 #include "grid.h"
 #include "player.h"
+#include "search.h"
+#include "timer.h"
 #include <stdlib.h>
-#include <time.h>
 #include <string.h>
 
-typedef struct {
-    int type; // 0 for horizontal, 1 for vertical
-    int r;
-    int c;
-} Move;
-
-static void GetValidMoves(const Grid *grid, Move *moves, int *move_count) {
-    *move_count = 0;
-    for (int r = 0; r <= grid->rows; r++) {
-        for (int c = 0; c < grid->cols; c++) {
-            int index = Grid_index_h(grid, r, c);
-            if (!grid->h_edges[index]) {
-                moves[*move_count].type = 0;
-                moves[*move_count].r = r;
-                moves[*move_count].c = c;
-                (*move_count)++;
-            }
-        }
-    }
-    for (int r = 0; r < grid->rows; r++) {
-        for (int c = 0; c <= grid->cols; c++) {
-            int index = Grid_index_v(grid, r, c);
-            if (!grid->v_edges[index]) {
-                moves[*move_count].type = 1;
-                moves[*move_count].r = r;
-                moves[*move_count].c = c;
-                (*move_count)++;
-            }
-        }
-    }
+// Uniformly random edge of class `cls`, or -1 if the class is empty.
+static int PickMove(Rng *rng, const Grid *grid, MoveClass cls) {
+    int count = Grid_count_moves(grid, cls);
+    if (count == 0) return -1;
+    return Grid_nth_move(grid, cls, Rng_Range(rng, count));
 }
 
-static int SimulateMove(Grid *grid, Move move) {
-    int claimed = 0;
-    
-    if (move.type == 0) {
-        // Horizontal move
-        int index = Grid_index_h(grid, move.r, move.c);
-        if (grid->h_edges[index]) return 0; // Already set
-        
-        grid->h_edges[index] = true;
-        
-        // Check boxes above and below
-        if (move.r > 0) {
-            int box_r = move.r - 1;
-            int box_c = move.c;
-            if (grid->owners[box_r * grid->cols + box_c] == -1 && Box_IsComplete(grid, box_r, box_c)) {
-                claimed++;
-            }
-        }
-        if (move.r < grid->rows) {
-            int box_r = move.r;
-            int box_c = move.c;
-            if (grid->owners[box_r * grid->cols + box_c] == -1 && Box_IsComplete(grid, box_r, box_c)) {
-                claimed++;
-            }
-        }
-    } else {
-        // Vertical move
-        int index = Grid_index_v(grid, move.r, move.c);
-        if (grid->v_edges[index]) return 0; // Already set
-        
-        grid->v_edges[index] = true;
-        
-        // Check boxes to the left and right
-        if (move.c > 0) {
-            int box_r = move.r;
-            int box_c = move.c - 1;
-            if (grid->owners[box_r * grid->cols + box_c] == -1 && Box_IsComplete(grid, box_r, box_c)) {
-                claimed++;
-            }
-        }
-        if (move.c < grid->cols) {
-            int box_r = move.r;
-            int box_c = move.c;
-            if (grid->owners[box_r * grid->cols + box_c] == -1 && Box_IsComplete(grid, box_r, box_c)) {
-                claimed++;
-            }
-        }
-    }
-    
-    return claimed;
+static int AI_Random(Rng *rng, const Grid *grid) {
+    return PickMove(rng, grid, MOVES_OPEN);
 }
 
-static void AI_Random(Game *game) {
-    Move moves[200];
-    int move_count = 0;
-    GetValidMoves(&game->grid, moves, &move_count);
+static int AI_Easy(Rng *rng, const Grid *grid) {
+    // Take a box whenever one is on offer
+    int edge = PickMove(rng, grid, MOVES_CAPTURE);
+    if (edge >= 0) return edge;
     
-    if (move_count == 0) return;
+    // If no box-completing move found, make a random move
+    return AI_Random(rng, grid);
+}
+
+static int AI_Medium(Rng *rng, const Grid *grid) {
+    int edge = PickMove(rng, grid, MOVES_CAPTURE);
+    if (edge >= 0) return edge;
     
-    int random_index = rand() % move_count;
-    Move selected_move = moves[random_index];
+    // Otherwise play a move that doesn't give the opponent a third side
+    edge = PickMove(rng, grid, MOVES_SAFE);
+    if (edge >= 0) return edge;
     
-    if (selected_move.type == 0) {
-        Grid_set_horizontal(&game->grid, selected_move.r, selected_move.c);
-        game->scores[game->current_player] += Box_CheckAndClaimAfterHorizontal(&game->grid, selected_move.r, selected_move.c, game->current_player);
-    } else {
-        Grid_set_vertical(&game->grid, selected_move.r, selected_move.c);
-        game->scores[game->current_player] += Box_CheckAndClaimAfterVertical(&game->grid, selected_move.r, selected_move.c, game->current_player);
+    // If no safe move is left, something has to be given away
+    return PickMove(rng, grid, MOVES_SACRIFICE);
+}
+
+int AI_PolicyMove(Rng *rng, const Grid *grid, AIDifficulty level) {
+    switch (level) {
+        case AI_DIFFICULTY_RANDOM:
+            return AI_Random(rng, grid);
+        case AI_DIFFICULTY_EASY:
+            return AI_Easy(rng, grid);
+        default:
+            return AI_Medium(rng, grid);
     }
 }
 
-static void AI_Easy(Game *game) {
-    Move moves[200];
-    int move_count = 0;
-    GetValidMoves(&game->grid, moves, &move_count);
-    
-    if (move_count == 0) return;
-    
-    // Try to find a move that completes a box
-    for (int i = 0; i < move_count; i++) {
-        Grid temp_grid;
-        temp_grid.rows = game->grid.rows;
-        temp_grid.cols = game->grid.cols;
-        
-        // Copy edges and owners
-        temp_grid.h_edges = malloc((game->grid.rows + 1) * game->grid.cols * sizeof(bool));
-        temp_grid.v_edges = malloc(game->grid.rows * (game->grid.cols + 1) * sizeof(bool));
-        temp_grid.owners = malloc(game->grid.rows * game->grid.cols * sizeof(int));
-        
-        memcpy(temp_grid.h_edges, game->grid.h_edges, (game->grid.rows + 1) * game->grid.cols * sizeof(bool));
-        memcpy(temp_grid.v_edges, game->grid.v_edges, game->grid.rows * (game->grid.cols + 1) * sizeof(bool));
-        memcpy(temp_grid.owners, game->grid.owners, game->grid.rows * game->grid.cols * sizeof(int));
-        
-        int claimed = SimulateMove(&temp_grid, moves[i]);
-        
-        free(temp_grid.h_edges);
-        free(temp_grid.v_edges);
-        free(temp_grid.owners);
-        
-        if (claimed > 0) {
-            // This move completes at least one box
-            if (moves[i].type == 0) {
-                Grid_set_horizontal(&game->grid, moves[i].r, moves[i].c);
-                game->scores[game->current_player] += Box_CheckAndClaimAfterHorizontal(&game->grid, moves[i].r, moves[i].c, game->current_player);
-            } else {
-                Grid_set_vertical(&game->grid, moves[i].r, moves[i].c);
-                game->scores[game->current_player] += Box_CheckAndClaimAfterVertical(&game->grid, moves[i].r, moves[i].c, game->current_player);
-            }
-            return;
-        }
+// The tablebase move, or -1 when the position is not covered or still has
+// too many edges left to probe.
+static int AI_Probe(AIContext *ai, const Grid *grid) {
+    if (!ai->tablebase) return -1;
+    int remaining = grid->num_edges - Bitset_Count(grid->edges, grid->edge_words);
+    if (remaining > ai->tb_max_edges) return -1;
+    return Tablebase_BestMove(ai->tablebase, grid);
+}
+
+static int AI_Hard(AIContext *ai, Grid *grid, int player, const SearchLimits *limits) {
+    if (!ai->tt.buckets && TT_Init(&ai->tt, ai->hash_mb)) {
+        ai->tt_rows = grid->rows;
+        ai->tt_cols = grid->cols;
     }
-    
-    // If no box-completing move found, make a random move
-    AI_Random(game);
+    // Entries from another board size would only be collisions here.
+    if (ai->tt.buckets && (ai->tt_rows != grid->rows || ai->tt_cols != grid->cols)) {
+        TT_Clear(&ai->tt);
+        ai->tt_rows = grid->rows;
+        ai->tt_cols = grid->cols;
+    }
+    SearchLimits bounded = *limits;
+    bounded.stop = &ai->stop;
+    bounded.endgame = &ai->endgame;
+#if TELEMETRY_ENABLED
+    uint64_t probes = ai->tt.probes;
+    uint64_t hits = ai->tt.hits;
+#endif
+    SearchResult result = Search_BestMove(grid, player, &bounded, ai->tt.buckets ? &ai->tt : NULL,
+                                          &ai->scratch);
+#if TELEMETRY_ENABLED
+    ai->last_move.nodes = result.nodes;
+    ai->last_move.depth = result.depth;
+    ai->last_move.tt_probes = ai->tt.probes - probes;
+    ai->last_move.tt_hits = ai->tt.hits - hits;
+#endif
+    return result.move;
 }
 
-static void AI_Medium(Game *game) {
-    Move moves[200];
-    int move_count = 0;
-    GetValidMoves(&game->grid, moves, &move_count);
-    
-    if (move_count == 0) return;
-    
-    // Try to find a move that doesn't give the opponent a chance to complete a box
-    for (int i = 0; i < move_count; i++) {
-        Grid temp_grid;
-        temp_grid.rows = game->grid.rows;
-        temp_grid.cols = game->grid.cols;
-        
-        // Copy edges and owners
-        temp_grid.h_edges = malloc((game->grid.rows + 1) * game->grid.cols * sizeof(bool));
-        temp_grid.v_edges = malloc(game->grid.rows * (game->grid.cols + 1) * sizeof(bool));
-        temp_grid.owners = malloc(game->grid.rows * game->grid.cols * sizeof(int));
-        
-        memcpy(temp_grid.h_edges, game->grid.h_edges, (game->grid.rows + 1) * game->grid.cols * sizeof(bool));
-        memcpy(temp_grid.v_edges, game->grid.v_edges, game->grid.rows * (game->grid.cols + 1) * sizeof(bool));
-        memcpy(temp_grid.owners, game->grid.owners, game->grid.rows * game->grid.cols * sizeof(int));
-        
-        int claimed = SimulateMove(&temp_grid, moves[i]);
-        
-        // If this move doesn't complete any boxes, it's safe
-        if (claimed == 0) {
-            if (moves[i].type == 0) {
-                Grid_set_horizontal(&game->grid, moves[i].r, moves[i].c);
-                game->scores[game->current_player] += Box_CheckAndClaimAfterHorizontal(&game->grid, moves[i].r, moves[i].c, game->current_player);
-            } else {
-                Grid_set_vertical(&game->grid, moves[i].r, moves[i].c);
-                game->scores[game->current_player] += Box_CheckAndClaimAfterVertical(&game->grid, moves[i].r, moves[i].c, game->current_player);
-            }
-            
-            free(temp_grid.h_edges);
-            free(temp_grid.v_edges);
-            free(temp_grid.owners);
-            return;
-        }
-        
-        free(temp_grid.h_edges);
-        free(temp_grid.v_edges);
-        free(temp_grid.owners);
+static int AI_Mcts(AIContext *ai, Grid *grid, int player) {
+    if (!ai->mcts) {
+        ai->mcts = malloc(sizeof(Mcts));
+        Mcts_Init(ai->mcts, ai->mcts_threads, MCTS_DEFAULT_NODES);
     }
-    
-    // If no safe move found, use the easy AI strategy
-    AI_Easy(game);
+    MctsLimits limits = ai->mcts_limits;
+    limits.stop = &ai->stop;
+    MctsResult result = Mcts_Search(ai->mcts, grid, player, &limits, Rng_Next(&ai->rng));
+#if TELEMETRY_ENABLED
+    ai->last_move.nodes = result.playouts;
+    ai->last_move.tree_nodes = result.tree_nodes;
+#endif
+    return result.move;
 }
 
-static void AI_Hard(Game *game) {
-    // For a hard AI, we would implement a minimax algorithm with alpha-beta pruning
-    // For simplicity, we'll use the medium strategy for now
-    AI_Medium(game);
+void AI_Init(AIContext *ai, uint64_t seed) {
+    Rng_Seed(&ai->rng, seed);
+    ai->tt.buckets = NULL;
+    ai->tt.num_buckets = 0;
+    ai->tt_rows = 0;
+    ai->tt_cols = 0;
+    ai->hash_mb = AI_HASH_MB;
+    ai->hard_limits.max_depth = 0;
+    ai->hard_limits.time_ms = AI_HARD_TIME_MS;
+    ai->hard_limits.max_nodes = 0;
+    ai->hard_limits.stop = NULL;
+    ai->hard_limits.info = NULL;
+    ai->hard_limits.endgame = NULL;
+    ai->scratch.plies = NULL;
+    ai->scratch.num_plies = 0;
+    ai->scratch.width = 0;
+    ai->mcts = NULL;
+    ai->mcts_threads = 0;
+    ai->mcts_limits.time_ms = AI_MCTS_TIME_MS;
+    ai->mcts_limits.max_playouts = 0;
+    ai->mcts_limits.rollout_level = AI_DIFFICULTY_MEDIUM;
+    ai->mcts_limits.exploration = 1.0;
+    ai->mcts_limits.stop = NULL;
+    ai->stop = 0;
+    ai->tablebase = NULL;
+    ai->tb_max_edges = AI_TB_MAX_EDGES;
+    ai->book = NULL;
+    Endgame_Init(&ai->endgame);
 }
 
-void AI_MakeMove(Game *game, AIDifficulty difficulty) {
-    static bool seeded = false;
-    if (!seeded) {
-        srand(time(NULL));
-        seeded = true;
+void AI_Free(AIContext *ai) {
+    TT_Free(&ai->tt);
+    Search_FreeScratch(&ai->scratch);
+    Endgame_Free(&ai->endgame);
+    if (ai->mcts) {
+        Mcts_Free(ai->mcts);
+        free(ai->mcts);
+        ai->mcts = NULL;
+    }
+}
+
+static int AI_Choose(AIContext *ai, Grid *grid, int player, AIDifficulty difficulty) {
+    if (difficulty == AI_DIFFICULTY_HARD || difficulty == AI_DIFFICULTY_MCTS) {
+        int edge = Book_Move(ai->book, grid, &ai->rng);
+#if TELEMETRY_ENABLED
+        ai->last_move.book = edge >= 0;
+#endif
+        if (edge >= 0) return edge;
+        edge = AI_Probe(ai, grid);
+#if TELEMETRY_ENABLED
+        ai->last_move.tablebase = edge >= 0;
+#endif
+        if (edge >= 0) return edge;
+        // Past the tablebase, a board of nothing but chains and loops is
+        // still solved outright.
+        edge = Endgame_BestMove(&ai->endgame, grid, NULL);
+#if TELEMETRY_ENABLED
+        ai->last_move.endgame = edge >= 0;
+#endif
+        if (edge >= 0) return edge;
     }
-    
     switch (difficulty) {
         case AI_DIFFICULTY_RANDOM:
-            AI_Random(game);
-            break;
         case AI_DIFFICULTY_EASY:
-            AI_Easy(game);
-            break;
         case AI_DIFFICULTY_MEDIUM:
-            AI_Medium(game);
-            break;
+            return AI_PolicyMove(&ai->rng, grid, difficulty);
         case AI_DIFFICULTY_HARD:
-            AI_Hard(game);
-            break;
+            return AI_Hard(ai, grid, player, &ai->hard_limits);
+        case AI_DIFFICULTY_MCTS:
+            return AI_Mcts(ai, grid, player);
+    }
+    return -1;
+}
+
+int AI_ChooseMove(AIContext *ai, Grid *grid, int player, AIDifficulty difficulty) {
+#if TELEMETRY_ENABLED
+    uint64_t start = Timer_NowNs();
+    memset(&ai->last_move, 0, sizeof(ai->last_move));
+    ai->last_move.difficulty = difficulty;
+    int edge = AI_Choose(ai, grid, player, difficulty);
+    ai->last_move.ms = Timer_ElapsedMs(start);
+    TELEMETRY_RECORD_MOVE(&ai->last_move);
+    return edge;
+#else
+    return AI_Choose(ai, grid, player, difficulty);
+#endif
+}
+
+void AI_Ponder(AIContext *ai, Grid *grid, int player, AIDifficulty difficulty) {
+    // Only Hard keeps anything between moves: MCTS rebuilds its tree.
+    if (difficulty != AI_DIFFICULTY_HARD) return;
+    if (Tablebase_Find(ai->tablebase, grid->rows, grid->cols)) return;
+    SearchLimits limits = { 0, 0, 0, NULL, NULL, NULL, NULL };
+    AI_Hard(ai, grid, player, &limits);
+}
+
+void AI_Stop(AIContext *ai) {
+    __atomic_store_n(&ai->stop, 1, __ATOMIC_RELAXED);
+}
+
+void AI_ClearStop(AIContext *ai) {
+    __atomic_store_n(&ai->stop, 0, __ATOMIC_RELAXED);
+}
+
+int AI_MakeMove(Game *game, AIDifficulty difficulty) {
+    static AIContext ai;
+    static Book book;
+    static bool ready = false;
+    if (!ready) {
+        AI_Init(&ai, Timer_NowNs());
+        // Optional, like the game's: without the file the opening is searched.
+        if (Book_Open(&book, BOOK_PATH)) ai.book = &book;
+        ready = true;
     }
-}
\ No newline at end of file
+    
+    int edge = AI_ChooseMove(&ai, &game->grid, game->current_player, difficulty);
+    if (edge < 0) return 0;
+    
+    int claimed = MoveStack_Make(&game->history, &game->grid, edge, game->current_player);
+    Players_SyncScores(game);
+    return claimed > 0 ? claimed : 0;
+}
@@ -0,0 +1,154 @@
+#define _POSIX_C_SOURCE 200809L
+#include "ai_worker.h"
+#include <time.h>
+
+// Copies `src` into `dst`, re-initialising `dst` if the board size changed.
+static void AIWorker_CopyGrid(Grid *dst, const Grid *src) {
+    if (dst->rows != src->rows || dst->cols != src->cols) {
+        Grid_Free(dst);
+        Grid_Clone(dst, src);
+    } else {
+        Grid_CopyInto(dst, src);
+    }
+}
+
+static void *AIWorker_Main(void *arg) {
+    AIWorker *w = arg;
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        while (!w->quit && w->job == AI_JOB_NONE) {
+            pthread_cond_wait(&w->wake, &w->lock);
+        }
+        if (w->quit) break;
+
+        AIJobKind job = w->job;
+        uint32_t generation = w->generation;
+        int player = w->player;
+        AIDifficulty difficulty = w->difficulty;
+        AIWorker_CopyGrid(&w->board, &w->pending);
+        w->job = AI_JOB_NONE;
+        // Cleared under the lock, so a cancel posted after this point sticks.
+        AI_ClearStop(&w->ai);
+        pthread_mutex_unlock(&w->lock);
+
+        int edge = -1;
+        if (job == AI_JOB_MOVE) {
+            edge = AI_ChooseMove(&w->ai, &w->board, player, difficulty);
+        } else {
+            AI_Ponder(&w->ai, &w->board, player, difficulty);
+        }
+
+        pthread_mutex_lock(&w->lock);
+        if (job == AI_JOB_MOVE && generation == w->generation) {
+            w->result = edge;
+            w->has_result = true;
+            pthread_cond_broadcast(&w->done);
+        }
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+void AIWorker_Init(AIWorker *w, uint64_t seed) {
+    AI_Init(&w->ai, seed);
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_cond_init(&w->wake, NULL);
+    pthread_cond_init(&w->done, NULL);
+    Grid_Init(&w->pending, 1, 1);
+    Grid_Init(&w->board, 1, 1);
+    w->player = 0;
+    w->difficulty = AI_DIFFICULTY_MEDIUM;
+    w->job = AI_JOB_NONE;
+    w->generation = 0;
+    w->quit = false;
+    w->has_result = false;
+    w->result = -1;
+    w->thinking = false;
+    pthread_create(&w->thread, NULL, AIWorker_Main, w);
+}
+
+void AIWorker_Free(AIWorker *w) {
+    pthread_mutex_lock(&w->lock);
+    w->quit = true;
+    AI_Stop(&w->ai);
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+    pthread_join(w->thread, NULL);
+
+    AI_Free(&w->ai);
+    Grid_Free(&w->pending);
+    Grid_Free(&w->board);
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->wake);
+    pthread_cond_destroy(&w->done);
+}
+
+static void AIWorker_Post(AIWorker *w, AIJobKind job, const Grid *grid, int player, AIDifficulty difficulty) {
+    pthread_mutex_lock(&w->lock);
+    w->generation++;
+    w->has_result = false;
+    w->job = job;
+    if (job != AI_JOB_NONE) {
+        AIWorker_CopyGrid(&w->pending, grid);
+        w->player = player;
+        w->difficulty = difficulty;
+    }
+    AI_Stop(&w->ai);
+    pthread_cond_signal(&w->wake);
+    pthread_mutex_unlock(&w->lock);
+}
+
+void AIWorker_Think(AIWorker *w, const Grid *grid, int player, AIDifficulty difficulty) {
+    AIWorker_Post(w, AI_JOB_MOVE, grid, player, difficulty);
+    w->thinking = true;
+}
+
+void AIWorker_Ponder(AIWorker *w, const Grid *grid, int player, AIDifficulty difficulty) {
+    // Pondering at a level that keeps nothing between moves would only burn
+    // a core, so don't wake the worker for it.
+    if (difficulty != AI_DIFFICULTY_HARD) return;
+    AIWorker_Post(w, AI_JOB_PONDER, grid, player, difficulty);
+    w->thinking = false;
+}
+
+void AIWorker_Cancel(AIWorker *w) {
+    AIWorker_Post(w, AI_JOB_NONE, NULL, 0, AI_DIFFICULTY_MEDIUM);
+    w->thinking = false;
+}
+
+bool AIWorker_Poll(AIWorker *w, int *edge) {
+    pthread_mutex_lock(&w->lock);
+    bool ready = w->has_result;
+    if (ready) {
+        *edge = w->result;
+        w->has_result = false;
+        w->thinking = false;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return ready;
+}
+
+bool AIWorker_Wait(AIWorker *w, int *edge, double timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    long long ns = deadline.tv_nsec + (long long)(timeout_ms > 0 ? timeout_ms * 1e6 : 0);
+    deadline.tv_sec += ns / 1000000000;
+    deadline.tv_nsec = ns % 1000000000;
+
+    pthread_mutex_lock(&w->lock);
+    while (w->thinking && !w->has_result) {
+        if (pthread_cond_timedwait(&w->done, &w->lock, &deadline) != 0) break;
+    }
+    bool ready = w->has_result;
+    if (ready) {
+        *edge = w->result;
+        w->has_result = false;
+        w->thinking = false;
+    }
+    pthread_mutex_unlock(&w->lock);
+    return ready;
+}
+
+bool AIWorker_IsThinking(const AIWorker *w) {
+    return w->thinking;
+}
@@ -0,0 +1,107 @@
+#define _POSIX_C_SOURCE 200809L
+#include "book.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool Book_Open(Book *book, const char *path) {
+    book->map = NULL;
+    book->map_size = 0;
+    book->header = NULL;
+    book->index = NULL;
+    book->entries = NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(BookHeader)) {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    // Check the header and that the index only points inside the entries,
+    // so probes never need to.
+    size_t size = st.st_size;
+    const BookHeader *header = map;
+    bool ok = memcmp(header->magic, BOOK_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == BOOK_VERSION && header->rows > 0 && header->cols > 0 &&
+              header->index_bits >= 1 && header->index_bits <= BOOK_MAX_INDEX_BITS &&
+              header->num_entries <= UINT32_MAX && Book_EntriesOffset(header) <= size &&
+              header->num_entries <= (size - Book_EntriesOffset(header)) / sizeof(BookEntry);
+    const uint32_t *index = (const uint32_t *)(header + 1);
+    uint32_t buckets = ok ? (uint32_t)1 << header->index_bits : 0;
+    for (uint32_t i = 0; ok && i < buckets; i++) {
+        ok = index[i] <= index[i + 1];
+    }
+    if (ok) ok = index[0] == 0 && index[buckets] == header->num_entries;
+    if (!ok) {
+        munmap(map, size);
+        return false;
+    }
+
+    book->map = map;
+    book->map_size = size;
+    book->header = header;
+    book->index = index;
+    book->entries = (const BookEntry *)((const uint8_t *)map + Book_EntriesOffset(header));
+    return true;
+}
+
+void Book_Close(Book *book) {
+    if (book->map) munmap(book->map, book->map_size);
+    book->map = NULL;
+    book->map_size = 0;
+    book->header = NULL;
+    book->index = NULL;
+    book->entries = NULL;
+}
+
+const BookEntry *Book_Find(const Book *book, const Grid *g, int *sym) {
+    if (!book || !book->map) return NULL;
+    const BookHeader *header = book->header;
+    if (header->rows != g->rows || header->cols != g->cols) return NULL;
+    if (g->num_edges - g->num_open >= header->plies) return NULL;
+
+    uint64_t key = Grid_canonical_hash(g, sym);
+    uint32_t bucket = Book_Bucket(key, header->index_bits);
+    for (uint32_t i = book->index[bucket]; i < book->index[bucket + 1]; i++) {
+        if (book->entries[i].key == key) return &book->entries[i];
+        if (book->entries[i].key > key) break;
+    }
+    return NULL;
+}
+
+int Book_Move(const Book *book, const Grid *g, Rng *rng) {
+    int sym;
+    const BookEntry *entry = Book_Find(book, g, &sym);
+    if (!entry) return -1;
+
+    // Only moves that are legal here count, in case of a key collision.
+    int edges[BOOK_MOVES];
+    int weights[BOOK_MOVES];
+    int count = 0;
+    int total = 0;
+    int inverse = Grid_sym_inverse(sym);
+    for (int i = 0; i < BOOK_MOVES && entry->weights[i] > 0; i++) {
+        if (entry->moves[i] >= g->num_edges) continue;
+        int edge = Grid_sym_edge(g, inverse, entry->moves[i]);
+        if (Grid_has_edge(g, edge)) continue;
+        edges[count] = edge;
+        weights[count] = entry->weights[i];
+        total += entry->weights[i];
+        count++;
+    }
+    if (count == 0) return -1;
+
+    int pick = Rng_Range(rng, total);
+    for (int i = 0; i < count; i++) {
+        if (pick < weights[i]) return edges[i];
+        pick -= weights[i];
+    }
+    return edges[count - 1];
+}
@@ -3,16 +3,20 @@
 
 bool Box_IsComplete(const Grid *g, int row, int col) {
     if (row < 0 || row >= g->rows || col < 0 || col >= g->cols) return false;
-    int h_top = Grid_index_h(g, row, col);
-    int h_bot = Grid_index_h(g, row + 1, col);
-    int v_left = Grid_index_v(g, row, col);
-    int v_right = Grid_index_v(g, row, col + 1);
-    return g->h_edges[h_top] && g->h_edges[h_bot] && g->v_edges[v_left] && g->v_edges[v_right];
+    return g->sides[row * g->cols + col] == 4;
+}
+
+static bool Box_IsOpen(const Grid *g, int row, int col) {
+    int b = row * g->cols + col;
+    return !Bitset_Test(g->owned[0], b) && !Bitset_Test(g->owned[1], b);
 }
 
 void Box_Claim(Grid *g, int row, int col, int player_id) {
     if (row < 0 || row >= g->rows || col < 0 || col >= g->cols) return;
-    g->owners[row * g->cols + col] = player_id;
+    if (!Box_IsOpen(g, row, col)) return;
+    Bitset_Set(g->owned[player_id], row * g->cols + col);
+    g->claimed[player_id]++;
+    g->claimed_total++;
 }
 
 int Box_CheckAndClaimAfterHorizontal(Grid *g, int edge_r, int edge_c, int player_id) {
@@ -20,7 +24,7 @@ int Box_CheckAndClaimAfterHorizontal(Grid *g, int edge_r, int edge_c, int player
     if (edge_r > 0) {
         int box_r = edge_r - 1;
         int box_c = edge_c;
-        if (g->owners[box_r * g->cols + box_c] == -1 && Box_IsComplete(g, box_r, box_c)) {
+        if (Box_IsOpen(g, box_r, box_c) && Box_IsComplete(g, box_r, box_c)) {
             Box_Claim(g, box_r, box_c, player_id);
             claimed++;
         }
@@ -28,7 +32,7 @@ int Box_CheckAndClaimAfterHorizontal(Grid *g, int edge_r, int edge_c, int player
     if (edge_r < g->rows) {
         int box_r = edge_r;
         int box_c = edge_c;
-        if (g->owners[box_r * g->cols + box_c] == -1 && Box_IsComplete(g, box_r, box_c)) {
+        if (Box_IsOpen(g, box_r, box_c) && Box_IsComplete(g, box_r, box_c)) {
             Box_Claim(g, box_r, box_c, player_id);
             claimed++;
         }
@@ -41,7 +45,7 @@ int Box_CheckAndClaimAfterVertical(Grid *g, int edge_r, int edge_c, int player_i
     if (edge_c > 0) {
         int box_r = edge_r;
         int box_c = edge_c - 1;
-        if (g->owners[box_r * g->cols + box_c] == -1 && Box_IsComplete(g, box_r, box_c)) {
+        if (Box_IsOpen(g, box_r, box_c) && Box_IsComplete(g, box_r, box_c)) {
             Box_Claim(g, box_r, box_c, player_id);
             claimed++;
         }
@@ -49,10 +53,55 @@ int Box_CheckAndClaimAfterVertical(Grid *g, int edge_r, int edge_c, int player_i
     if (edge_c < g->cols) {
         int box_r = edge_r;
         int box_c = edge_c;
-        if (g->owners[box_r * g->cols + box_c] == -1 && Box_IsComplete(g, box_r, box_c)) {
+        if (Box_IsOpen(g, box_r, box_c) && Box_IsComplete(g, box_r, box_c)) {
             Box_Claim(g, box_r, box_c, player_id);
             claimed++;
         }
     }
     return claimed;
-}
\ No newline at end of file
+}
+
+int Box_CheckAndClaimAfterEdge(Grid *g, int edge, int player_id) {
+    const int *boxes = Grid_edge_boxes(g, edge);
+    int claimed = 0;
+    for (int i = 0; i < 2; i++) {
+        int b = boxes[i];
+        if (b >= 0 && g->sides[b] == 4 && !Bitset_Test(g->owned[0], b) && !Bitset_Test(g->owned[1], b)) {
+            Bitset_Set(g->owned[player_id], b);
+            claimed++;
+        }
+    }
+    g->claimed[player_id] += claimed;
+    g->claimed_total += claimed;
+    return claimed;
+}
+
+int Box_Sides(const Grid *g, int row, int col) {
+    return g->sides[row * g->cols + col];
+}
+
+// Number of boxes that drawing the (undrawn) edge would complete.
+int Box_CapturesFor(const Grid *g, int edge) {
+    if (!Bitset_Test(g->capture_moves, edge)) return 0;
+    const int *boxes = Grid_edge_boxes(g, edge);
+    int captures = 0;
+    for (int i = 0; i < 2; i++) {
+        if (boxes[i] >= 0 && g->sides[boxes[i]] == 3) captures++;
+    }
+    return captures;
+}
+
+// Reverts the claims made by drawing `edge`. A box next to the edge can only
+// have been completed by that edge, so any owner bit on it goes.
+void Box_UnclaimAfterEdge(Grid *g, int edge) {
+    const int *boxes = Grid_edge_boxes(g, edge);
+    for (int i = 0; i < 2; i++) {
+        if (boxes[i] < 0) continue;
+        for (int p = 0; p < 2; p++) {
+            if (!Bitset_Test(g->owned[p], boxes[i])) continue;
+            Bitset_Clear(g->owned[p], boxes[i]);
+            g->claimed[p]--;
+            g->claimed_total--;
+        }
+    }
+}
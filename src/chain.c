@@ -0,0 +1,181 @@
+#include "chain.h"
+#include "grid.h"
+#include <stdlib.h>
+
+// The four edges of a box: top, bottom, left, right.
+static void Chains_BoxEdges(const Grid *g, int box, int edges[4]) {
+    int r = box / g->cols;
+    int c = box % g->cols;
+    edges[0] = r * g->cols + c;
+    edges[1] = edges[0] + g->cols;
+    edges[2] = g->num_h + r * (g->cols + 1) + c;
+    edges[3] = edges[2] + 1;
+}
+
+static int Chains_Across(const Grid *g, int box, int edge) {
+    const int *boxes = Grid_edge_boxes(g, edge);
+    return boxes[0] == box ? boxes[1] : boxes[0];
+}
+
+static int Chains_Shortest(const int *hist, int from, int max) {
+    for (int len = from; len <= max; len++) {
+        if (hist[len] > 0) return len;
+    }
+    return 0;
+}
+
+static void Chains_Count(ChainSet *cs, int run, int delta) {
+    int len = cs->length[run];
+    cs->run_boxes += delta * len;
+    cs->shape_hash += (uint64_t)(int64_t)delta * Chains_ShapeKey(len, cs->loop[run]);
+    if (cs->loop[run]) {
+        cs->loop_hist[len] += delta;
+        cs->num_loops += delta;
+        if (delta > 0 && (cs->shortest_loop == 0 || len < cs->shortest_loop)) cs->shortest_loop = len;
+        if (delta < 0 && len == cs->shortest_loop && cs->loop_hist[len] == 0) {
+            cs->shortest_loop = Chains_Shortest(cs->loop_hist, len, cs->num_boxes);
+        }
+    } else {
+        cs->chain_hist[len] += delta;
+        cs->num_chains += delta;
+        if (len >= CHAIN_LONG) cs->num_long_chains += delta;
+        if (delta > 0 && (cs->shortest_chain == 0 || len < cs->shortest_chain)) cs->shortest_chain = len;
+        if (delta < 0 && len == cs->shortest_chain && cs->chain_hist[len] == 0) {
+            cs->shortest_chain = Chains_Shortest(cs->chain_hist, len, cs->num_boxes);
+        }
+    }
+}
+
+// Grows a run from `start` over two-sided boxes joined by undrawn edges.
+static void Chains_Build(ChainSet *cs, const Grid *g, int start) {
+    int run = cs->free_runs[--cs->num_free];
+    int count = 0;
+    int links = 0;
+    cs->queue[count++] = start;
+    cs->chain_of[start] = run;
+    for (int i = 0; i < count; i++) {
+        int box = cs->queue[i];
+        int edges[4];
+        Chains_BoxEdges(g, box, edges);
+        for (int k = 0; k < 4; k++) {
+            if (Grid_has_edge(g, edges[k])) continue;
+            int other = Chains_Across(g, box, edges[k]);
+            if (other < 0 || g->sides[other] != 2) continue;
+            if (cs->chain_of[other] == -1) {
+                cs->chain_of[other] = run;
+                cs->queue[count++] = other;
+            }
+            links++;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        cs->next[cs->queue[i]] = cs->queue[(i + 1) % count];
+    }
+    cs->head[run] = start;
+    cs->length[run] = count;
+    // Every link was seen from both ends; a closed run has as many links as boxes.
+    cs->loop[run] = links / 2 == count;
+    Chains_Count(cs, run, 1);
+}
+
+static int Chains_Remove(ChainSet *cs, int run, int *out) {
+    int n = 0;
+    int box = cs->head[run];
+    do {
+        int next = cs->next[box];
+        cs->chain_of[box] = -1;
+        out[n++] = box;
+        box = next;
+    } while (box != cs->head[run]);
+    Chains_Count(cs, run, -1);
+    cs->free_runs[cs->num_free++] = run;
+    return n;
+}
+
+void Chains_Attach(ChainSet *cs, Grid *g) {
+    int n = g->num_boxes;
+    cs->num_boxes = n;
+    cs->chain_of = malloc(n * sizeof(int));
+    cs->next = malloc(n * sizeof(int));
+    cs->head = malloc(n * sizeof(int));
+    cs->length = malloc(n * sizeof(int));
+    cs->loop = malloc(n * sizeof(bool));
+    cs->free_runs = malloc(n * sizeof(int));
+    cs->chain_hist = calloc(n + 1, sizeof(int));
+    cs->loop_hist = calloc(n + 1, sizeof(int));
+    // Removed runs plus the boxes around one edge.
+    cs->pending = malloc((n + 16) * sizeof(int));
+    cs->queue = malloc(n * sizeof(int));
+    cs->num_free = n;
+    for (int i = 0; i < n; i++) {
+        cs->chain_of[i] = -1;
+        cs->free_runs[i] = n - 1 - i;
+    }
+    cs->num_chains = cs->num_long_chains = cs->num_loops = 0;
+    cs->shortest_chain = cs->shortest_loop = 0;
+    cs->run_boxes = 0;
+    cs->shape_hash = 0;
+
+    for (int b = 0; b < n; b++) {
+        if (g->sides[b] == 2 && cs->chain_of[b] == -1) Chains_Build(cs, g, b);
+    }
+    g->chains = cs;
+}
+
+void Chains_Detach(ChainSet *cs, Grid *g) {
+    if (g->chains == cs) g->chains = NULL;
+    free(cs->chain_of);
+    free(cs->next);
+    free(cs->head);
+    free(cs->length);
+    free(cs->loop);
+    free(cs->free_runs);
+    free(cs->chain_hist);
+    free(cs->loop_hist);
+    free(cs->pending);
+    free(cs->queue);
+}
+
+// Called after `edge` was drawn or cleared and the side counts updated. Only
+// runs containing the two boxes beside the edge or their undrawn-edge
+// neighbours can have changed; those are dissolved and re-walked.
+void Chains_EdgeChanged(ChainSet *cs, const Grid *g, int edge) {
+    const int *boxes = Grid_edge_boxes(g, edge);
+    // Runs only change when a box beside the edge enters or leaves the
+    // two-sided state.
+    int delta = Grid_has_edge(g, edge) ? 1 : -1;
+    bool touched = false;
+    for (int i = 0; i < 2; i++) {
+        if (boxes[i] < 0) continue;
+        int sides = g->sides[boxes[i]];
+        if (sides == 2 || sides - delta == 2) touched = true;
+    }
+    if (!touched) return;
+
+    int seeds[10];
+    int num_seeds = 0;
+    for (int i = 0; i < 2; i++) {
+        if (boxes[i] < 0) continue;
+        seeds[num_seeds++] = boxes[i];
+        int edges[4];
+        Chains_BoxEdges(g, boxes[i], edges);
+        for (int k = 0; k < 4; k++) {
+            if (edges[k] == edge || Grid_has_edge(g, edges[k])) continue;
+            int other = Chains_Across(g, boxes[i], edges[k]);
+            if (other >= 0) seeds[num_seeds++] = other;
+        }
+    }
+
+    int num_pending = 0;
+    for (int i = 0; i < num_seeds; i++) {
+        int run = cs->chain_of[seeds[i]];
+        if (run >= 0) num_pending += Chains_Remove(cs, run, cs->pending + num_pending);
+    }
+    for (int i = 0; i < num_seeds; i++) {
+        cs->pending[num_pending++] = seeds[i];
+    }
+    for (int i = 0; i < num_pending; i++) {
+        int box = cs->pending[i];
+        if (g->sides[box] == 2 && cs->chain_of[box] == -1) Chains_Build(cs, g, box);
+    }
+}
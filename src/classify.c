@@ -0,0 +1,212 @@
+#include "classify.h"
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CLASSIFY_X86 1
+#include <immintrin.h>
+#else
+#define CLASSIFY_X86 0
+#endif
+
+// Row buffers are padded so vector loops may run past the row end.
+#define CLASSIFY_PAD 32
+
+typedef struct {
+    const char *name;
+    // sides[c] = top[c] + bottom[c] + vert[c] + vert[c + 1] for c < n
+    void (*sum_row)(const uint8_t *top, const uint8_t *bottom, const uint8_t *vert, uint8_t *sides, int n);
+    // For c < n, with m = max(x[c], y[c]): sets bit + c in `capture` if m is
+    // 3 and in `safe` if m is at most 1.
+    void (*class_row)(const uint8_t *x, const uint8_t *y, int n, uint64_t *capture, uint64_t *safe, int bit);
+} ClassifyOps;
+
+static uint64_t classify_expand[256];  // byte b -> one 0/1 byte per bit
+static pthread_once_t classify_once = PTHREAD_ONCE_INIT;
+static const ClassifyOps *classify_ops;
+
+// ORs the low `width` bits of `mask` into `set` starting at `bit`.
+static inline void Classify_Deposit(uint64_t *set, int bit, uint64_t mask, int width) {
+    if (width < 64) mask &= ((uint64_t)1 << width) - 1;
+    if (!mask) return;
+    int w = bit >> 6, shift = bit & 63;
+    set[w] |= mask << shift;
+    if (shift && shift + width > 64) set[w + 1] |= mask >> (64 - shift);
+}
+
+// Bits [bit, bit + n) of a set of `words` words as 0/1 bytes, zero-padded.
+static void Classify_Unpack(const uint64_t *set, int words, int bit, int n, uint8_t *out) {
+    for (int i = 0; i < n; i += 8) {
+        int o = bit + i;
+        int w = o >> 6, shift = o & 63;
+        uint64_t word = set[w] >> shift;
+        if (shift > 56 && w + 1 < words) word |= set[w + 1] << (64 - shift);
+        memcpy(out + i, &classify_expand[word & 0xFF], 8);
+    }
+    memset(out + n, 0, CLASSIFY_PAD);
+}
+
+static void Scalar_SumRow(const uint8_t *top, const uint8_t *bottom, const uint8_t *vert, uint8_t *sides, int n) {
+    for (int c = 0; c < n; c++) {
+        sides[c] = (uint8_t)(top[c] + bottom[c] + vert[c] + vert[c + 1]);
+    }
+}
+
+static void Scalar_ClassRow(const uint8_t *x, const uint8_t *y, int n, uint64_t *capture, uint64_t *safe, int bit) {
+    for (int c = 0; c < n; c++) {
+        int m = x[c] > y[c] ? x[c] : y[c];
+        if (m == 3) capture[(bit + c) >> 6] |= (uint64_t)1 << ((bit + c) & 63);
+        if (m <= 1) safe[(bit + c) >> 6] |= (uint64_t)1 << ((bit + c) & 63);
+    }
+}
+
+static const ClassifyOps classify_scalar = { "scalar", Scalar_SumRow, Scalar_ClassRow };
+
+#if CLASSIFY_X86
+
+__attribute__((target("sse2")))
+static void Sse2_SumRow(const uint8_t *top, const uint8_t *bottom, const uint8_t *vert, uint8_t *sides, int n) {
+    for (int c = 0; c < n; c += 16) {
+        __m128i s = _mm_add_epi8(_mm_loadu_si128((const __m128i *)(top + c)),
+                                 _mm_loadu_si128((const __m128i *)(bottom + c)));
+        s = _mm_add_epi8(s, _mm_loadu_si128((const __m128i *)(vert + c)));
+        s = _mm_add_epi8(s, _mm_loadu_si128((const __m128i *)(vert + c + 1)));
+        _mm_storeu_si128((__m128i *)(sides + c), s);
+    }
+}
+
+__attribute__((target("sse2")))
+static void Sse2_ClassRow(const uint8_t *x, const uint8_t *y, int n, uint64_t *capture, uint64_t *safe, int bit) {
+    const __m128i three = _mm_set1_epi8(3);
+    const __m128i one = _mm_set1_epi8(1);
+    for (int c = 0; c < n; c += 16) {
+        __m128i m = _mm_max_epu8(_mm_loadu_si128((const __m128i *)(x + c)),
+                                 _mm_loadu_si128((const __m128i *)(y + c)));
+        uint64_t cap = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(m, three));
+        uint64_t low = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(m, one), m));
+        int width = n - c < 16 ? n - c : 16;
+        Classify_Deposit(capture, bit + c, cap, width);
+        Classify_Deposit(safe, bit + c, low, width);
+    }
+}
+
+static const ClassifyOps classify_sse2 = { "sse2", Sse2_SumRow, Sse2_ClassRow };
+
+__attribute__((target("avx2")))
+static void Avx2_SumRow(const uint8_t *top, const uint8_t *bottom, const uint8_t *vert, uint8_t *sides, int n) {
+    for (int c = 0; c < n; c += 32) {
+        __m256i s = _mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(top + c)),
+                                    _mm256_loadu_si256((const __m256i *)(bottom + c)));
+        s = _mm256_add_epi8(s, _mm256_loadu_si256((const __m256i *)(vert + c)));
+        s = _mm256_add_epi8(s, _mm256_loadu_si256((const __m256i *)(vert + c + 1)));
+        _mm256_storeu_si256((__m256i *)(sides + c), s);
+    }
+}
+
+__attribute__((target("avx2")))
+static void Avx2_ClassRow(const uint8_t *x, const uint8_t *y, int n, uint64_t *capture, uint64_t *safe, int bit) {
+    const __m256i three = _mm256_set1_epi8(3);
+    const __m256i one = _mm256_set1_epi8(1);
+    for (int c = 0; c < n; c += 32) {
+        __m256i m = _mm256_max_epu8(_mm256_loadu_si256((const __m256i *)(x + c)),
+                                    _mm256_loadu_si256((const __m256i *)(y + c)));
+        uint64_t cap = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(m, three));
+        uint64_t low = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(m, one), m));
+        int width = n - c < 32 ? n - c : 32;
+        Classify_Deposit(capture, bit + c, cap, width);
+        Classify_Deposit(safe, bit + c, low, width);
+    }
+}
+
+static const ClassifyOps classify_avx2 = { "avx2", Avx2_SumRow, Avx2_ClassRow };
+
+#endif
+
+static void Classify_Setup(void) {
+    for (int b = 0; b < 256; b++) {
+        uint64_t bytes = 0;
+        for (int i = 0; i < 8; i++) {
+            bytes |= (uint64_t)((b >> i) & 1) << (8 * i);
+        }
+        classify_expand[b] = bytes;
+    }
+    const ClassifyOps *ops = &classify_scalar;
+#if CLASSIFY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) ops = &classify_avx2;
+    else if (__builtin_cpu_supports("sse2")) ops = &classify_sse2;
+#endif
+    __atomic_store_n(&classify_ops, ops, __ATOMIC_RELEASE);
+}
+
+static const ClassifyOps *Classify_Ops(void) {
+    pthread_once(&classify_once, Classify_Setup);
+    return __atomic_load_n(&classify_ops, __ATOMIC_ACQUIRE);
+}
+
+const char *Classify_Impl(void) {
+    return Classify_Ops()->name;
+}
+
+bool Classify_Use(const char *name) {
+    Classify_Ops();
+    const ClassifyOps *ops = NULL;
+    if (strcmp(name, "scalar") == 0) ops = &classify_scalar;
+#if CLASSIFY_X86
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) ops = &classify_sse2;
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) ops = &classify_avx2;
+#endif
+    if (!ops) return false;
+    __atomic_store_n(&classify_ops, ops, __ATOMIC_RELEASE);
+    return true;
+}
+
+void Classify_Grid(Grid *g) {
+    const ClassifyOps *ops = Classify_Ops();
+    int rows = g->rows, cols = g->cols;
+    int width = cols + 2 + CLASSIFY_PAD;
+    uint8_t top[cols + CLASSIFY_PAD + 8];
+    uint8_t bottom[cols + CLASSIFY_PAD + 8];
+    uint8_t vert[cols + 1 + CLASSIFY_PAD + 8];
+    // Side counts of the previous and current box rows, with a zero on
+    // either side so vertical edges on the border see an empty neighbour.
+    uint8_t band[2][width];
+    memset(band, 0, sizeof(band));
+    uint8_t *prev = band[0], *cur = band[1];
+
+    memset(g->capture_moves, 0, g->edge_words * sizeof(uint64_t));
+    memset(g->safe_moves, 0, g->edge_words * sizeof(uint64_t));
+    Classify_Unpack(g->edges, g->edge_words, 0, cols, top);
+    for (int r = 0; r < rows; r++) {
+        Classify_Unpack(g->edges, g->edge_words, (r + 1) * cols, cols, bottom);
+        Classify_Unpack(g->edges, g->edge_words, g->num_h + r * (cols + 1), cols + 1, vert);
+        ops->sum_row(top, bottom, vert, cur + 1, cols);
+        memset(cur + 1 + cols, 0, width - cols - 1);
+        memcpy(g->sides + r * cols, cur + 1, cols);
+
+        ops->class_row(prev + 1, cur + 1, cols, g->capture_moves, g->safe_moves, r * cols);
+        ops->class_row(cur, cur + 1, cols + 1, g->capture_moves, g->safe_moves, g->num_h + r * (cols + 1));
+        memcpy(top, bottom, cols + CLASSIFY_PAD);
+        uint8_t *t = prev;
+        prev = cur;
+        cur = t;
+    }
+    // Bottom border: the last box row above, nothing below.
+    memset(cur, 0, width);
+    ops->class_row(prev + 1, cur + 1, cols, g->capture_moves, g->safe_moves, rows * cols);
+
+    // Only undrawn edges have a class.
+    int open = 0, captures = 0, safe = 0;
+    for (int w = 0; w < g->edge_words; w++) {
+        uint64_t undrawn = ~g->edges[w];
+        if (w == g->edge_words - 1) undrawn &= Bitset_TailMask(g->num_edges);
+        g->capture_moves[w] &= undrawn;
+        g->safe_moves[w] &= undrawn & ~g->capture_moves[w];
+        open += __builtin_popcountll(undrawn);
+        captures += __builtin_popcountll(g->capture_moves[w]);
+        safe += __builtin_popcountll(g->safe_moves[w]);
+    }
+    g->num_open = open;
+    g->num_capture = captures;
+    g->num_safe = safe;
+}
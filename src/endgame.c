@@ -0,0 +1,203 @@
+#include "endgame.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ENDGAME_MIN_CAPACITY 1024
+// Past this many slots a full cache is cleared rather than grown.
+#define ENDGAME_MAX_CAPACITY ((size_t)1 << 22)
+
+// One run shape and how many runs of it are left.
+typedef struct {
+    int length;
+    bool loop;
+    int count;
+} EndgameShape;
+
+void Endgame_Init(Endgame *eg) {
+    eg->keys = NULL;
+    eg->values = NULL;
+    eg->capacity = 0;
+    eg->count = 0;
+    eg->probes = 0;
+    eg->hits = 0;
+}
+
+void Endgame_Free(Endgame *eg) {
+    free(eg->keys);
+    free(eg->values);
+    Endgame_Init(eg);
+}
+
+static bool Endgame_Probe(Endgame *eg, uint64_t key, int *value) {
+    eg->probes++;
+    if (!eg->capacity) return false;
+    for (size_t i = key & (eg->capacity - 1);; i = (i + 1) & (eg->capacity - 1)) {
+        if (eg->keys[i] == 0) return false;
+        if (eg->keys[i] == key) {
+            eg->hits++;
+            *value = eg->values[i];
+            return true;
+        }
+    }
+}
+
+static void Endgame_Insert(Endgame *eg, uint64_t key, int value) {
+    size_t i = key & (eg->capacity - 1);
+    while (eg->keys[i] != 0 && eg->keys[i] != key) i = (i + 1) & (eg->capacity - 1);
+    eg->count += eg->keys[i] == 0;
+    eg->keys[i] = key;
+    eg->values[i] = value;
+}
+
+static void Endgame_Store(Endgame *eg, uint64_t key, int value) {
+    if (key == 0) return;
+    if ((eg->count + 1) * 2 > eg->capacity) {
+        if (eg->capacity >= ENDGAME_MAX_CAPACITY) {
+            memset(eg->keys, 0, eg->capacity * sizeof(uint64_t));
+            eg->count = 0;
+        } else {
+            uint64_t *keys = eg->keys;
+            int32_t *values = eg->values;
+            size_t old = eg->capacity;
+            eg->capacity = old ? 2 * old : ENDGAME_MIN_CAPACITY;
+            eg->keys = calloc(eg->capacity, sizeof(uint64_t));
+            eg->values = malloc(eg->capacity * sizeof(int32_t));
+            eg->count = 0;
+            for (size_t i = 0; i < old; i++) {
+                if (keys[i]) Endgame_Insert(eg, keys[i], values[i]);
+            }
+            free(keys);
+            free(values);
+        }
+    }
+    Endgame_Insert(eg, key, value);
+}
+
+// What opening a run of `length` is worth to the side to move, given the
+// value `rest` of the runs left after it for whoever moves next.
+static int Endgame_Open(int length, bool loop, int rest) {
+    int take = length + rest;
+    int keep = INT_MIN;
+    if (loop) keep = length - 8 - rest;
+    else if (length >= 3) keep = length - 4 - rest;
+    return -(take > keep ? take : keep);
+}
+
+static int Endgame_Solve(Endgame *eg, EndgameShape *shapes, int num_shapes, uint64_t key, int left) {
+    if (left == 0) return 0;
+    int value;
+    if (Endgame_Probe(eg, key, &value)) return value;
+    int best = INT_MIN;
+    for (int i = 0; i < num_shapes; i++) {
+        EndgameShape *s = &shapes[i];
+        if (s->count == 0) continue;
+        s->count--;
+        int rest = Endgame_Solve(eg, shapes, num_shapes, key - Chains_ShapeKey(s->length, s->loop),
+                                 left - s->length);
+        s->count++;
+        int v = Endgame_Open(s->length, s->loop, rest);
+        if (v > best) best = v;
+    }
+    Endgame_Store(eg, key, best);
+    return best;
+}
+
+// The distinct run shapes of `cs`, shortest chains first, then loops.
+static EndgameShape *Endgame_Shapes(const ChainSet *cs, int *num_shapes) {
+    int n = 0;
+    for (int len = 1; len <= cs->num_boxes; len++) {
+        n += (cs->chain_hist[len] > 0) + (cs->loop_hist[len] > 0);
+    }
+    EndgameShape *shapes = malloc((n ? n : 1) * sizeof(EndgameShape));
+    n = 0;
+    for (int loop = 0; loop < 2; loop++) {
+        const int *hist = loop ? cs->loop_hist : cs->chain_hist;
+        for (int len = 1; len <= cs->num_boxes; len++) {
+            if (hist[len] == 0) continue;
+            shapes[n].length = len;
+            shapes[n].loop = loop;
+            shapes[n].count = hist[len];
+            n++;
+        }
+    }
+    *num_shapes = n;
+    return shapes;
+}
+
+bool Endgame_Value(Endgame *eg, const Grid *g, int *value) {
+    if (!Endgame_IsSimple(g)) return false;
+    const ChainSet *cs = g->chains;
+    if (cs->run_boxes == 0) {
+        *value = 0;
+        return true;
+    }
+    if (Endgame_Probe(eg, cs->shape_hash, value)) return true;
+    int num_shapes;
+    EndgameShape *shapes = Endgame_Shapes(cs, &num_shapes);
+    *value = Endgame_Solve(eg, shapes, num_shapes, cs->shape_hash, cs->run_boxes);
+    free(shapes);
+    return true;
+}
+
+// The edge that opens run `run`: the middle of a two-chain, the border end
+// of a longer chain, anywhere in a loop or a single box.
+static int Endgame_OpeningEdge(const Grid *g, int run) {
+    const ChainSet *cs = g->chains;
+    int length = cs->length[run];
+    bool loop = cs->loop[run];
+    int box = cs->head[run];
+    do {
+        int r = box / g->cols;
+        int c = box % g->cols;
+        int top = r * g->cols + c;
+        int left = g->num_h + r * (g->cols + 1) + c;
+        int edges[4] = { top, top + g->cols, left, left + 1 };
+        for (int k = 0; k < 4; k++) {
+            if (Grid_has_edge(g, edges[k])) continue;
+            const int *boxes = Grid_edge_boxes(g, edges[k]);
+            int other = boxes[0] == box ? boxes[1] : boxes[0];
+            if (loop || length == 1) return edges[k];
+            if (length == 2 && other >= 0) return edges[k];
+            if (length >= 3 && other < 0) return edges[k];
+        }
+        box = cs->next[box];
+    } while (box != cs->head[run]);
+    return -1;
+}
+
+int Endgame_BestMove(Endgame *eg, Grid *g, int *value) {
+    ChainSet chains;
+    bool own_chains = g->chains == NULL;
+    if (own_chains) Chains_Attach(&chains, g);
+    const ChainSet *cs = g->chains;
+    int edge = -1;
+    if (Endgame_IsSimple(g) && cs->run_boxes > 0) {
+        int num_shapes;
+        EndgameShape *shapes = Endgame_Shapes(cs, &num_shapes);
+        int best = INT_MIN;
+        EndgameShape pick = shapes[0];
+        for (int i = 0; i < num_shapes; i++) {
+            EndgameShape *s = &shapes[i];
+            s->count--;
+            int rest = Endgame_Solve(eg, shapes, num_shapes, cs->shape_hash - Chains_ShapeKey(s->length, s->loop),
+                                     cs->run_boxes - s->length);
+            s->count++;
+            int v = Endgame_Open(s->length, s->loop, rest);
+            if (v > best) {
+                best = v;
+                pick = *s;
+            }
+        }
+        free(shapes);
+        for (int b = 0; b < g->num_boxes && edge < 0; b++) {
+            int run = cs->chain_of[b];
+            if (run >= 0 && cs->head[run] == b && cs->length[run] == pick.length && cs->loop[run] == pick.loop) {
+                edge = Endgame_OpeningEdge(g, run);
+            }
+        }
+        if (value) *value = best;
+    }
+    if (own_chains) Chains_Detach(&chains, g);
+    return edge;
+}
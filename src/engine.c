@@ -0,0 +1,399 @@
+#define _POSIX_C_SOURCE 200809L
+#include "engine.h"
+#include "ai.h"
+#include "book.h"
+#include "grid.h"
+#include "movestack.h"
+#include "player.h"
+#include "tablebase.h"
+#include "timer.h"
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ENGINE_NAME "dots-and-boxes"
+#define ENGINE_DEFAULT_SIZE 5
+#define ENGINE_MAX_LINE 65536
+
+typedef struct {
+    FILE *in;
+    FILE *out;
+    pthread_mutex_t out_lock;   // the search thread writes too
+    AIContext ai;
+    Tablebase tablebase;
+    bool has_tablebase;
+    Book book;
+    bool has_book;
+    AIDifficulty level;         // used by go without a level
+    Grid grid;
+    MoveStack moves;            // moves played since the last bulk load
+    int player;                 // side to move
+
+    // The running search works on its own copy of the board.
+    pthread_t thread;
+    bool searching;
+    Grid board;
+    int board_player;
+    AIDifficulty board_level;
+} Engine;
+
+static const char *engine_levels[] = { "random", "easy", "medium", "hard", "mcts" };
+
+static void Engine_Send(Engine *e, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    pthread_mutex_lock(&e->out_lock);
+    vfprintf(e->out, fmt, args);
+    fputc('\n', e->out);
+    fflush(e->out);
+    pthread_mutex_unlock(&e->out_lock);
+    va_end(args);
+}
+
+static bool Engine_ParseLevel(const char *name, AIDifficulty *level) {
+    for (int i = 0; i < (int)(sizeof(engine_levels) / sizeof(engine_levels[0])); i++) {
+        if (name && strcmp(name, engine_levels[i]) == 0) {
+            *level = (AIDifficulty)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Parses a whole word as an integer in [min, max].
+static bool Engine_ParseInt(const char *word, long long min, long long max, long long *value) {
+    if (!word) return false;
+    char *end;
+    long long v = strtoll(word, &end, 10);
+    if (end == word || *end || v < min || v > max) return false;
+    *value = v;
+    return true;
+}
+
+static void Engine_Info(void *arg, const SearchResult *result) {
+    Engine *e = arg;
+    double nps = result->elapsed_ms > 0 ? result->nodes * 1000.0 / result->elapsed_ms : 0.0;
+    Engine_Send(e, "info depth %d score %d nodes %lld time %.0f nps %.0f move %d", result->depth,
+                result->score, (long long)result->nodes, result->elapsed_ms, nps, result->move);
+}
+
+static void *Engine_Search(void *arg) {
+    Engine *e = arg;
+    uint64_t start = Timer_NowNs();
+    int edge = AI_ChooseMove(&e->ai, &e->board, e->board_player, e->board_level);
+    if (e->board_level != AI_DIFFICULTY_HARD) {
+        Engine_Send(e, "info time %.0f", Timer_ElapsedMs(start));
+    }
+    Engine_Send(e, "bestmove %d", edge);
+    return NULL;
+}
+
+// Stops the search, if any, and waits for its bestmove.
+static void Engine_Stop(Engine *e) {
+    if (!e->searching) return;
+    AI_Stop(&e->ai);
+    pthread_join(e->thread, NULL);
+    AI_ClearStop(&e->ai);
+    Grid_Free(&e->board);
+    e->searching = false;
+}
+
+// Positions on boards of different sizes share edge indices, so nothing
+// learned on one size may be reused on another.
+static void Engine_Forget(Engine *e) {
+    if (e->ai.tt.buckets) TT_Clear(&e->ai.tt);
+}
+
+static void Engine_Resize(Engine *e, int rows, int cols) {
+    Grid_Free(&e->grid);
+    MoveStack_Free(&e->moves);
+    Grid_Init(&e->grid, rows, cols);
+    MoveStack_Init(&e->moves, e->grid.num_edges);
+    e->player = 0;
+}
+
+static void Engine_Clear(Engine *e) {
+    int rows = e->grid.rows, cols = e->grid.cols;
+    Grid_Free(&e->grid);
+    Grid_Init(&e->grid, rows, cols);
+    MoveStack_Clear(&e->moves);
+    e->player = 0;
+}
+
+static bool Engine_Play(Engine *e, const char *word) {
+    long long edge;
+    if (!Engine_ParseInt(word, 0, e->grid.num_edges - 1, &edge)) {
+        Engine_Send(e, "info string error: bad edge '%s'", word ? word : "");
+        return false;
+    }
+    int claimed = MoveStack_Make(&e->moves, &e->grid, (int)edge, e->player);
+    if (claimed < 0) {
+        Engine_Send(e, "info string error: edge %lld is already drawn", edge);
+        return false;
+    }
+    if (Player_ShouldSwitch(claimed)) e->player = 1 - e->player;
+    return true;
+}
+
+static void Engine_Moves(Engine *e, char **save) {
+    for (char *word = strtok_r(NULL, " \t", save); word; word = strtok_r(NULL, " \t", save)) {
+        if (!Engine_Play(e, word)) return;
+    }
+}
+
+// Reads "S0 S1" after a score keyword, when `save` is not NULL, and hands
+// the complete boxes of the position just loaded out to match: which boxes
+// are whose does not matter to play, only how many. Without a score the
+// position may have no complete box.
+static bool Engine_Score(Engine *e, char **save, const uint64_t *edges) {
+    Grid *g = &e->grid;
+    long long score[2] = { 0, 0 };
+    if (save) {
+        for (int p = 0; p < 2; p++) {
+            if (!Engine_ParseInt(strtok_r(NULL, " \t", save), 0, g->num_boxes, &score[p])) {
+                Engine_Send(e, "info string error: score needs two box counts");
+                return false;
+            }
+        }
+    }
+    if (score[0] + score[1] != g->claimed_total) {
+        Engine_Send(e, "info string error: score %lld %lld does not add up to the %d complete boxes", score[0],
+                    score[1], g->claimed_total);
+        Engine_Clear(e);
+        return false;
+    }
+    if (score[1] == 0) return true;
+    uint64_t *owned1 = calloc(g->box_words, sizeof(uint64_t));
+    for (int b = 0, n = 0; b < g->num_boxes && n < score[1]; b++) {
+        if (g->sides[b] == 4) {
+            Bitset_Set(owned1, b);
+            n++;
+        }
+    }
+    Grid_SetPosition(g, edges, owned1);
+    free(owned1);
+    return true;
+}
+
+static void Engine_Position(Engine *e, char **save) {
+    char *word = strtok_r(NULL, " \t", save);
+    Engine_Clear(e);
+    if (word && strcmp(word, "startpos") == 0) {
+        word = strtok_r(NULL, " \t", save);
+    } else if (word && strcmp(word, "edges") == 0) {
+        uint64_t *edges = calloc(e->grid.edge_words, sizeof(uint64_t));
+        long long value;
+        for (word = strtok_r(NULL, " \t", save); word; word = strtok_r(NULL, " \t", save)) {
+            if (strcmp(word, "score") == 0 || strcmp(word, "turn") == 0 || strcmp(word, "moves") == 0) break;
+            if (!Engine_ParseInt(word, 0, e->grid.num_edges - 1, &value)) {
+                Engine_Send(e, "info string error: bad edge '%s'", word);
+                free(edges);
+                return;
+            }
+            Bitset_Set(edges, (int)value);
+        }
+        Grid_SetPosition(&e->grid, edges, NULL);
+        bool ok = Engine_Score(e, word && strcmp(word, "score") == 0 ? save : NULL, edges);
+        free(edges);
+        if (!ok) return;
+        if (word && strcmp(word, "score") == 0) word = strtok_r(NULL, " \t", save);
+        if (word && strcmp(word, "turn") == 0) {
+            if (!Engine_ParseInt(strtok_r(NULL, " \t", save), 0, 1, &value)) {
+                Engine_Send(e, "info string error: turn must be 0 or 1");
+                return;
+            }
+            e->player = (int)value;
+            word = strtok_r(NULL, " \t", save);
+        }
+    } else {
+        Engine_Send(e, "info string error: position needs startpos or edges");
+        return;
+    }
+    if (!word) return;
+    if (strcmp(word, "moves") != 0) {
+        Engine_Send(e, "info string error: unexpected '%s'", word);
+        return;
+    }
+    Engine_Moves(e, save);
+}
+
+static void Engine_Go(Engine *e, char **save) {
+    AIDifficulty level = e->level;
+    long long depth = 0, movetime = -1, nodes = 0;
+    bool infinite = false;
+    for (char *word = strtok_r(NULL, " \t", save); word; word = strtok_r(NULL, " \t", save)) {
+        if (strcmp(word, "infinite") == 0) {
+            infinite = true;
+        } else if (strcmp(word, "level") == 0) {
+            if (!Engine_ParseLevel(strtok_r(NULL, " \t", save), &level)) {
+                Engine_Send(e, "info string error: unknown level");
+                return;
+            }
+        } else if (strcmp(word, "depth") == 0 || strcmp(word, "movetime") == 0 || strcmp(word, "nodes") == 0) {
+            long long *slot = word[0] == 'd' ? &depth : word[0] == 'm' ? &movetime : &nodes;
+            if (!Engine_ParseInt(strtok_r(NULL, " \t", save), 0, INT32_MAX, slot)) {
+                Engine_Send(e, "info string error: '%s' needs a number", word);
+                return;
+            }
+        } else {
+            Engine_Send(e, "info string error: unknown go option '%s'", word);
+            return;
+        }
+    }
+
+    // The default think time only applies when nothing else bounds the
+    // search; infinite runs until stop.
+    bool bounded = depth || nodes || infinite;
+    SearchLimits hard = { (int)depth, 0, nodes, NULL, Engine_Info, e, NULL };
+    hard.time_ms = movetime >= 0 ? (int)movetime : bounded ? 0 : AI_HARD_TIME_MS;
+    MctsLimits mcts = e->ai.mcts_limits;
+    mcts.time_ms = movetime >= 0 ? (int)movetime : bounded ? 0 : AI_MCTS_TIME_MS;
+    mcts.max_playouts = infinite ? INT64_MAX : nodes;
+
+    e->ai.hard_limits = hard;
+    e->ai.mcts_limits = mcts;
+    Grid_Clone(&e->board, &e->grid);
+    e->board_player = e->player;
+    e->board_level = level;
+    e->searching = true;
+    pthread_create(&e->thread, NULL, Engine_Search, e);
+}
+
+static void Engine_SetOption(Engine *e, char **save) {
+    char *word = strtok_r(NULL, " \t", save);
+    char *name = strtok_r(NULL, " \t", save);
+    char *keyword = strtok_r(NULL, " \t", save);
+    char *value = strtok_r(NULL, "", save);
+    while (value && (*value == ' ' || *value == '\t')) value++;
+    if (!word || strcmp(word, "name") != 0 || !name || !keyword || strcmp(keyword, "value") != 0 || !value) {
+        Engine_Send(e, "info string error: setoption name NAME value VALUE");
+        return;
+    }
+    long long number;
+    if (strcmp(name, "Hash") == 0 && Engine_ParseInt(value, 1, 1 << 16, &number)) {
+        TT_Free(&e->ai.tt);
+        e->ai.hash_mb = (size_t)number;
+    } else if (strcmp(name, "Threads") == 0 && Engine_ParseInt(value, 0, 1024, &number)) {
+        // The pool is rebuilt with the new size on the next MCTS search.
+        if (e->ai.mcts) {
+            Mcts_Free(e->ai.mcts);
+            free(e->ai.mcts);
+            e->ai.mcts = NULL;
+        }
+        e->ai.mcts_threads = (int)number;
+    } else if (strcmp(name, "Tablebase") == 0) {
+        if (e->has_tablebase) Tablebase_Close(&e->tablebase);
+        e->has_tablebase = Tablebase_Open(&e->tablebase, value);
+        e->ai.tablebase = e->has_tablebase ? &e->tablebase : NULL;
+        if (!e->has_tablebase) Engine_Send(e, "info string error: cannot open tablebase '%s'", value);
+    } else if (strcmp(name, "Book") == 0) {
+        if (e->has_book) Book_Close(&e->book);
+        e->has_book = Book_Open(&e->book, value);
+        e->ai.book = e->has_book ? &e->book : NULL;
+        if (!e->has_book) Engine_Send(e, "info string error: cannot open book '%s'", value);
+    } else if (strcmp(name, "Level") != 0 || !Engine_ParseLevel(value, &e->level)) {
+        Engine_Send(e, "info string error: bad option %s = '%s'", name, value);
+    }
+}
+
+// Rows of dots with the drawn edges, then the scores and side to move.
+static void Engine_Display(Engine *e) {
+    const Grid *g = &e->grid;
+    char line[4 * GAME_MAX_SIZE + 8];
+    for (int r = 0; r <= g->rows; r++) {
+        int n = 0;
+        for (int c = 0; c < g->cols; c++) {
+            n += sprintf(line + n, "+%s", Grid_has_h(g, r, c) ? "---" : "   ");
+        }
+        sprintf(line + n, "+");
+        Engine_Send(e, "info string %s", line);
+        if (r == g->rows) break;
+        n = 0;
+        for (int c = 0; c <= g->cols; c++) {
+            int owner = c < g->cols ? Grid_box_owner(g, r, c) : -1;
+            n += sprintf(line + n, "%c %c ", Grid_has_v(g, r, c) ? '|' : ' ', owner < 0 ? ' ' : '0' + owner);
+        }
+        while (n > 0 && line[n - 1] == ' ') n--;
+        line[n] = '\0';
+        Engine_Send(e, "info string %s", line);
+    }
+    Engine_Send(e, "info string score %d %d turn %d hash %016llx", g->claimed[0], g->claimed[1], e->player,
+                (unsigned long long)Grid_canonical_hash(g, NULL));
+}
+
+int Engine_Run(FILE *in, FILE *out) {
+    Engine e;
+    e.in = in;
+    e.out = out;
+    pthread_mutex_init(&e.out_lock, NULL);
+    AI_Init(&e.ai, Timer_NowNs());
+    e.has_tablebase = false;
+    e.has_book = false;
+    e.level = AI_DIFFICULTY_HARD;
+    Grid_Init(&e.grid, ENGINE_DEFAULT_SIZE, ENGINE_DEFAULT_SIZE);
+    MoveStack_Init(&e.moves, e.grid.num_edges);
+    e.player = 0;
+    e.searching = false;
+
+    char *line = malloc(ENGINE_MAX_LINE);
+    while (fgets(line, ENGINE_MAX_LINE, in)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char *save;
+        char *command = strtok_r(line, " \t", &save);
+        if (!command) continue;
+        if (strcmp(command, "quit") == 0) break;
+
+        if (strcmp(command, "dab") == 0) {
+            Engine_Send(&e, "id name " ENGINE_NAME);
+            Engine_Send(&e, "option name Hash type spin default %d min 1 max 65536", AI_HASH_MB);
+            Engine_Send(&e, "option name Threads type spin default 0 min 0 max 1024");
+            Engine_Send(&e, "option name Tablebase type string default <empty>");
+            Engine_Send(&e, "option name Book type string default <empty>");
+            Engine_Send(&e, "option name Level type combo default hard var random var easy var medium var hard var mcts");
+            Engine_Send(&e, "dabok");
+        } else if (strcmp(command, "isready") == 0) {
+            Engine_Send(&e, "readyok");
+        } else if (strcmp(command, "stop") == 0) {
+            Engine_Stop(&e);
+        } else if (strcmp(command, "d") == 0) {
+            Engine_Display(&e);
+        } else {
+            Engine_Stop(&e);
+            if (strcmp(command, "go") == 0) {
+                Engine_Go(&e, &save);
+            } else if (strcmp(command, "position") == 0) {
+                Engine_Position(&e, &save);
+            } else if (strcmp(command, "play") == 0) {
+                Engine_Play(&e, strtok_r(NULL, " \t", &save));
+            } else if (strcmp(command, "newgame") == 0) {
+                Engine_Forget(&e);
+                Engine_Clear(&e);
+            } else if (strcmp(command, "size") == 0) {
+                long long rows, cols;
+                if (Engine_ParseInt(strtok_r(NULL, " \t", &save), 1, GAME_MAX_SIZE, &rows) &&
+                    Engine_ParseInt(strtok_r(NULL, " \t", &save), 1, GAME_MAX_SIZE, &cols)) {
+                    if (rows != e.grid.rows || cols != e.grid.cols) Engine_Forget(&e);
+                    Engine_Resize(&e, (int)rows, (int)cols);
+                } else {
+                    Engine_Send(&e, "info string error: size ROWS COLS, 1 to %d each", GAME_MAX_SIZE);
+                }
+            } else if (strcmp(command, "setoption") == 0) {
+                Engine_SetOption(&e, &save);
+            } else {
+                Engine_Send(&e, "info string error: unknown command '%s'", command);
+            }
+        }
+    }
+
+    Engine_Stop(&e);
+    free(line);
+    MoveStack_Free(&e.moves);
+    Grid_Free(&e.grid);
+    AI_Free(&e.ai);
+    if (e.has_tablebase) Tablebase_Close(&e.tablebase);
+    if (e.has_book) Book_Close(&e.book);
+    pthread_mutex_destroy(&e.out_lock);
+    return 0;
+}
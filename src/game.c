@@ -1,28 +1,377 @@
 #include "game.h"
 #include "raylib.h"
 #include "ai.h"
+#include "ai_worker.h"
+#include "book.h"
+#include "record.h"
+#include "tablebase.h"
+#include "telemetry.h"
+#include "timer.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 Game game;
 
-void InitGame(GameMode mode) {
+// The AI thinks on its own thread; UpdateGame only polls for its answer.
+static AIWorker ai_worker;
+static AIDifficulty ai_difficulty = AI_DIFFICULTY_MEDIUM;
+static bool ai_ponder = true;
+// AI vs AI without frame pacing: UpdateGame plays moves for up to
+// TURBO_FRAME_MS per frame and only the last position is drawn.
+static bool turbo;
+#define TURBO_FRAME_MS 15.0
+
+// Undrawn edge under the pointer while a human is to move, else -1.
+static int hover_edge = -1;
+static Tablebase tablebase;
+static Book book;
+
+// Finished games are appended to the record file once one is given.
+static RecordWriter recorder;
+static RecordBuffer record;
+static bool recording;
+
+// Boards are drawn from (100, 100) with cells of at most 40 px, shrunk to
+// fit the window for large sizes.
+#define BOARD_OFFSET 100
+#define BOARD_MARGIN 20
+#define MAX_CELL_SIZE 40
+#define MIN_CELL_SIZE 2
+
+static const char *mode_names[] = { "Player vs Player", "Player vs AI", "AI vs AI", "Solo" };
+
+// Player colours live with the renderer so the rules code stays raylib-free.
+static Color PlayerColor(int id) {
+    return id == 0 ? RED : BLUE;
+}
+
+static void LayoutBoard(void) {
+    int fit_w = (GetScreenWidth() - BOARD_OFFSET - BOARD_MARGIN) / game.grid.cols;
+    int fit_h = (GetScreenHeight() - BOARD_OFFSET - BOARD_MARGIN) / game.grid.rows;
+    int cell = fit_w < fit_h ? fit_w : fit_h;
+    if (cell > MAX_CELL_SIZE) cell = MAX_CELL_SIZE;
+    if (cell < MIN_CELL_SIZE) cell = MIN_CELL_SIZE;
+    game.cell_size = cell;
+    game.offset_x = BOARD_OFFSET;
+    game.offset_y = BOARD_OFFSET;
+}
+
+// The static board lives in a render texture. Each frame only the edges and
+// boxes that differ from the copies taken at the last repaint are drawn
+// into it, so an idle frame costs one textured quad whatever the board size.
+#define BOARD_PAD 4
+
+typedef struct {
+    RenderTexture2D target;
+    bool loaded;
+    int rows, cols, cell_size;
+    uint64_t *edges;        // edge set as last painted
+    uint64_t *owned[2];     // box owners as last painted
+} BoardCache;
+
+static BoardCache board_cache;
+
+static float DotRadius(void) {
+    return game.cell_size >= 12 ? 3.0f : 1.0f;
+}
+
+static void BoardCache_PaintDot(int r, int c) {
+    DrawCircle(BOARD_PAD + c * game.cell_size, BOARD_PAD + r * game.cell_size, DotRadius(), BLACK);
+}
+
+// Repaints an edge and the dots at its ends, which the line overlaps.
+static void BoardCache_PaintEdge(const Grid *g, int edge) {
+    int r, c, dr = 0, dc = 0;
+    if (edge < g->num_h) {
+        r = edge / g->cols;
+        c = edge % g->cols;
+        dc = 1;
+    } else {
+        r = (edge - g->num_h) / (g->cols + 1);
+        c = (edge - g->num_h) % (g->cols + 1);
+        dr = 1;
+    }
+    int x = BOARD_PAD + c * game.cell_size;
+    int y = BOARD_PAD + r * game.cell_size;
+    Color color = Grid_has_edge(g, edge) ? BLACK : LIGHTGRAY;
+    DrawLine(x, y, x + dc * game.cell_size, y + dr * game.cell_size, color);
+    BoardCache_PaintDot(r, c);
+    BoardCache_PaintDot(r + dr, c + dc);
+}
+
+// Repaints the inside of a box, which no edge or dot reaches.
+static void BoardCache_PaintBox(const Grid *g, int box) {
+    int r = box / g->cols;
+    int c = box % g->cols;
+    int x = BOARD_PAD + c * game.cell_size + 2;
+    int y = BOARD_PAD + r * game.cell_size + 2;
+    int size = game.cell_size - 4;
+    DrawRectangle(x, y, size, size, RAYWHITE);
+    int owner = Grid_box_owner(g, r, c);
+    if (owner != -1) {
+        DrawRectangle(x, y, size, size, Fade(PlayerColor(owner), 0.3f));
+    }
+}
+
+static void BoardCache_Free(void) {
+    BoardCache *bc = &board_cache;
+    if (!bc->loaded) return;
+    UnloadRenderTexture(bc->target);
+    free(bc->edges);
+    free(bc->owned[0]);
+    free(bc->owned[1]);
+    bc->loaded = false;
+}
+
+static void BoardCache_Snapshot(const Grid *g) {
+    BoardCache *bc = &board_cache;
+    memcpy(bc->edges, g->edges, g->edge_words * sizeof(uint64_t));
+    memcpy(bc->owned[0], g->owned[0], g->box_words * sizeof(uint64_t));
+    memcpy(bc->owned[1], g->owned[1], g->box_words * sizeof(uint64_t));
+}
+
+static void BoardCache_Rebuild(const Grid *g) {
+    BoardCache *bc = &board_cache;
+    BoardCache_Free();
+    bc->rows = g->rows;
+    bc->cols = g->cols;
+    bc->cell_size = game.cell_size;
+    bc->edges = malloc(g->edge_words * sizeof(uint64_t));
+    bc->owned[0] = malloc(g->box_words * sizeof(uint64_t));
+    bc->owned[1] = malloc(g->box_words * sizeof(uint64_t));
+    bc->target = LoadRenderTexture(g->cols * game.cell_size + 2 * BOARD_PAD,
+                                   g->rows * game.cell_size + 2 * BOARD_PAD);
+    bc->loaded = true;
+
+    BeginTextureMode(bc->target);
+    ClearBackground(RAYWHITE);
+    for (int e = 0; e < g->num_edges; e++) {
+        BoardCache_PaintEdge(g, e);
+    }
+    for (int b = 0; b < g->num_boxes; b++) {
+        BoardCache_PaintBox(g, b);
+    }
+    EndTextureMode();
+    BoardCache_Snapshot(g);
+}
+
+// Brings the texture up to date with game.grid.
+static void BoardCache_Sync(void) {
+    const Grid *g = &game.grid;
+    BoardCache *bc = &board_cache;
+    if (!bc->loaded || bc->rows != g->rows || bc->cols != g->cols || bc->cell_size != game.cell_size) {
+        BoardCache_Rebuild(g);
+        return;
+    }
+
+    bool painting = false;
+    for (int w = 0; w < g->edge_words; w++) {
+        uint64_t changed = g->edges[w] ^ bc->edges[w];
+        if (changed && !painting) {
+            BeginTextureMode(bc->target);
+            painting = true;
+        }
+        while (changed) {
+            BoardCache_PaintEdge(g, w * 64 + Bitset_Ctz(changed));
+            changed &= changed - 1;
+        }
+    }
+    for (int w = 0; w < g->box_words; w++) {
+        uint64_t changed = (g->owned[0][w] ^ bc->owned[0][w]) | (g->owned[1][w] ^ bc->owned[1][w]);
+        if (changed && !painting) {
+            BeginTextureMode(bc->target);
+            painting = true;
+        }
+        while (changed) {
+            BoardCache_PaintBox(g, w * 64 + Bitset_Ctz(changed));
+            changed &= changed - 1;
+        }
+    }
+    if (painting) {
+        EndTextureMode();
+        BoardCache_Snapshot(g);
+    }
+}
+
+static int ClampSize(int size) {
+    if (size < 1) return 1;
+    if (size > GAME_MAX_SIZE) return GAME_MAX_SIZE;
+    return size;
+}
+
+void InitGame(GameMode mode, int rows, int cols) {
     game.mode = mode;
     game.state = STATE_PLAYING;
     game.current_player = 0;
-    game.scores[0] = 0;
-    game.scores[1] = 0;
     game.extra_turn = false;
-    game.cell_size = 40;
-    game.offset_x = 100;
-    game.offset_y = 100;
+    game.rows = ClampSize(rows);
+    game.cols = ClampSize(cols);
     
-    Grid_Init(&game.grid, 5, 5);
+    Grid_Init(&game.grid, game.rows, game.cols);
+    MoveStack_Init(&game.history, game.grid.num_edges);
+    LayoutBoard();
     Players_Init(&game);
+    Players_SyncScores(&game);
+    AIWorker_Init(&ai_worker, Timer_NowNs());
+    // Optional: without the file the AI just searches.
+    if (Tablebase_Open(&tablebase, TABLEBASE_PATH)) {
+        ai_worker.ai.tablebase = &tablebase;
+    }
+    if (Book_Open(&book, BOOK_PATH)) {
+        ai_worker.ai.book = &book;
+    }
 }
 
-void UpdateGame(void) {
-    if (game.state != STATE_PLAYING) return;
+bool StartRecording(const char *path) {
+    if (recording) return true;
+    if (!RecordWriter_Open(&recorder, path)) return false;
+    RecordBuffer_Init(&record);
+    recording = true;
+    return true;
+}
+
+void CloseGame(void) {
+    if (recording) {
+        RecordWriter_Close(&recorder);
+        RecordBuffer_Free(&record);
+        recording = false;
+    }
+    BoardCache_Free();
+    AIWorker_Free(&ai_worker);
+    Tablebase_Close(&tablebase);
+    Book_Close(&book);
+    MoveStack_Free(&game.history);
+    Grid_Free(&game.grid);
+}
+
+// Hands the turn over after a move and, if a human is to play against the
+// AI, lets the worker think on their time.
+static void FinishMove(int claimed) {
+    Players_SyncScores(&game);
+    if (recording && Game_IsOver(&game.grid)) {
+        // Undone moves are gone from the history, so it holds the game as played out.
+        RecordBuffer_Begin(&record, game.grid.rows, game.grid.cols);
+        for (int i = 0; i < game.history.count; i++) {
+            RecordBuffer_Move(&record, game.history.moves[i].edge);
+        }
+        RecordWriter_Append(&recorder, &record);
+        RecordWriter_Flush(&recorder);
+    }
+    if (Player_ShouldSwitch(claimed)) {
+        Player_Switch(&game);
+    }
+    if (ai_ponder && !Game_IsOver(&game.grid) && !game.players[game.current_player].is_ai &&
+        game.players[1 - game.current_player].is_ai) {
+        AIWorker_Ponder(&ai_worker, &game.grid, game.current_player, ai_difficulty);
+    }
+}
+
+// Ctrl+Z takes moves back and Ctrl+Y replays them. Against the AI both step
+// over its moves, so the human is to move again afterwards.
+static void StepHistory(bool redo) {
+    AIWorker_Cancel(&ai_worker);
+    bool skip_ai = game.players[0].is_ai != game.players[1].is_ai;
+    const MoveRecord *m;
+    while ((m = redo ? MoveStack_Redo(&game.history, &game.grid) : MoveStack_Undo(&game.history, &game.grid))) {
+        game.current_player = redo ? MoveRecord_NextPlayer(m) : m->player;
+        if (!skip_ai || !game.players[game.current_player].is_ai) break;
+    }
+    Players_SyncScores(&game);
+}
+
+void ShowMenu(void) {
+    AIWorker_Cancel(&ai_worker);
+    game.state = STATE_MENU;
+}
+
+// Arrow keys pick the board size (with Shift in steps of 10), Tab the mode
+// and Enter starts.
+static void UpdateMenu(void) {
+    int step = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT) ? 10 : 1;
+    if (IsKeyPressed(KEY_UP)) game.rows = ClampSize(game.rows + step);
+    if (IsKeyPressed(KEY_DOWN)) game.rows = ClampSize(game.rows - step);
+    if (IsKeyPressed(KEY_RIGHT)) game.cols = ClampSize(game.cols + step);
+    if (IsKeyPressed(KEY_LEFT)) game.cols = ClampSize(game.cols - step);
+    if (IsKeyPressed(KEY_TAB)) {
+        game.mode = (GameMode)((game.mode + 1) % (int)(sizeof(mode_names) / sizeof(mode_names[0])));
+    }
+    if (IsKeyPressed(KEY_ENTER)) {
+        Players_Init(&game);
+        ResetGrid();
+    }
+}
+
+// The undrawn edge nearest to `pos`, or -1 if it is off the board or drawn.
+static int EdgeAt(Vector2 pos) {
+    // Convert mouse position to grid coordinates
+    int grid_x = (pos.x - game.offset_x) / game.cell_size;
+    int grid_y = (pos.y - game.offset_y) / game.cell_size;
+    float rel_x = (pos.x - game.offset_x) - grid_x * game.cell_size;
+    float rel_y = (pos.y - game.offset_y) - grid_y * game.cell_size;
+    
+    // Determine if the point is closer to a horizontal or vertical edge
+    bool is_horizontal = rel_y < rel_x;
+    if (rel_y > game.cell_size - rel_x) {
+        is_horizontal = rel_y > rel_x;
+    }
+    
+    int edge = -1;
+    if (is_horizontal) {
+        if (grid_y >= 0 && grid_y <= game.grid.rows && 
+            grid_x >= 0 && grid_x < game.grid.cols) {
+            edge = Grid_index_h(&game.grid, grid_y, grid_x);
+        }
+    } else {
+        if (grid_y >= 0 && grid_y < game.grid.rows && 
+            grid_x >= 0 && grid_x <= game.grid.cols) {
+            edge = Grid_index_v(&game.grid, grid_y, grid_x);
+        }
+    }
+    return edge >= 0 && !Grid_has_edge(&game.grid, edge) ? edge : -1;
+}
+
+// Starts the AI on its move or plays the move once it is ready. In turbo
+// mode it waits for the worker instead of polling, and keeps going until the
+// frame's budget is spent or the game ends.
+static void UpdateAI(void) {
+    bool fast = turbo && game.mode == MODE_MVM;
+    uint64_t start = Timer_NowNs();
+    do {
+        int edge;
+        if (!AIWorker_IsThinking(&ai_worker)) {
+            AIWorker_Think(&ai_worker, &game.grid, game.current_player, ai_difficulty);
+            if (!fast) return;
+        }
+        bool ready = fast ? AIWorker_Wait(&ai_worker, &edge, TURBO_FRAME_MS - Timer_ElapsedMs(start))
+                          : AIWorker_Poll(&ai_worker, &edge);
+        if (!ready || edge < 0) return;
+        int claimed = MoveStack_Make(&game.history, &game.grid, edge, game.current_player);
+        if (claimed >= 0) FinishMove(claimed);
+    } while (fast && !Game_IsOver(&game.grid) && game.players[game.current_player].is_ai &&
+             Timer_ElapsedMs(start) < TURBO_FRAME_MS);
+}
+
+static void UpdateState(void) {
+    hover_edge = -1;
+    if (game.state == STATE_MENU) {
+        UpdateMenu();
+        return;
+    }
+    if (game.state == STATE_GAME_OVER) {
+        if (IsKeyPressed(KEY_R)) {
+            ResetGrid();
+        } else if (IsKeyPressed(KEY_M)) {
+            ShowMenu();
+        }
+        return;
+    }
+    
+    if (IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL)) {
+        if (IsKeyPressed(KEY_Z)) StepHistory(false);
+        if (IsKeyPressed(KEY_Y)) StepHistory(true);
+    }
+    if (IsKeyPressed(KEY_T) && game.mode == MODE_MVM) turbo = !turbo;
     
     if (Game_IsOver(&game.grid)) {
         game.state = STATE_GAME_OVER;
@@ -30,118 +379,182 @@ void UpdateGame(void) {
     }
     
     if (game.players[game.current_player].is_ai) {
-        AIDifficulty difficulty = AI_DIFFICULTY_MEDIUM;
-        AI_MakeMove(&game, difficulty);
-        
-        if (Player_ShouldSwitch(0)) {
-            Player_Switch(&game);
-        }
+        UpdateAI();
     } else {
         // Handle player input
-        if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-            Vector2 mousePos = GetMousePosition();
-            
-            // Convert mouse position to grid coordinates
-            int grid_x = (mousePos.x - game.offset_x) / game.cell_size;
-            int grid_y = (mousePos.y - game.offset_y) / game.cell_size;
-            float rel_x = (mousePos.x - game.offset_x) - grid_x * game.cell_size;
-            float rel_y = (mousePos.y - game.offset_y) - grid_y * game.cell_size;
-            
-            // Determine if click is closer to horizontal or vertical edge
-            bool is_horizontal = rel_y < rel_x;
-            if (rel_y > game.cell_size - rel_x) {
-                is_horizontal = rel_y > rel_x;
-            }
-            
-            int claimed = 0;
-            if (is_horizontal) {
-                // Click is on a horizontal edge
-                if (grid_y >= 0 && grid_y <= game.grid.rows && 
-                    grid_x >= 0 && grid_x < game.grid.cols) {
-                    if (Grid_set_horizontal(&game.grid, grid_y, grid_x)) {
-                        claimed = Box_CheckAndClaimAfterHorizontal(&game.grid, grid_y, grid_x, game.current_player);
-                        game.scores[game.current_player] += claimed;
-                    }
-                }
-            } else {
-                // Click is on a vertical edge
-                if (grid_y >= 0 && grid_y < game.grid.rows && 
-                    grid_x >= 0 && grid_x <= game.grid.cols) {
-                    if (Grid_set_vertical(&game.grid, grid_y, grid_x)) {
-                        claimed = Box_CheckAndClaimAfterVertical(&game.grid, grid_y, grid_x, game.current_player);
-                        game.scores[game.current_player] += claimed;
-                    }
-                }
-            }
-            
-            // Switch player if no boxes were claimed
-            if (Player_ShouldSwitch(claimed)) {
-                Player_Switch(&game);
+        hover_edge = EdgeAt(GetMousePosition());
+        if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON) && hover_edge >= 0) {
+            // Switch player unless the move claimed a box
+            int claimed = MoveStack_Make(&game.history, &game.grid, hover_edge, game.current_player);
+            if (claimed >= 0) {
+                FinishMove(claimed);
+                hover_edge = -1;
             }
         }
     }
 }
 
+#if TELEMETRY_ENABLED
+// F3 shows the AI and frame-time counters over the board.
+static bool telemetry_overlay;
+static double frame_update_ms;
+static uint64_t frame_draw_start;
+#endif
+
+void UpdateGame(void) {
+#if TELEMETRY_ENABLED
+    uint64_t start = Timer_NowNs();
+    if (IsKeyPressed(KEY_F3)) telemetry_overlay = !telemetry_overlay;
+    UpdateState();
+    frame_update_ms = Timer_ElapsedMs(start);
+#else
+    UpdateState();
+#endif
+}
+
+static void DrawMenu(void) {
+    DrawText("Dots and Boxes", 100, 100, 40, BLACK);
+    DrawText(TextFormat("Rows: %d   (Up/Down)", game.rows), 100, 180, 20, DARKGRAY);
+    DrawText(TextFormat("Cols: %d   (Left/Right)", game.cols), 100, 210, 20, DARKGRAY);
+    DrawText(TextFormat("Mode: %s   (Tab)", mode_names[game.mode]), 100, 240, 20, DARKGRAY);
+    DrawText("Hold Shift for steps of 10, Enter to start", 100, 290, 20, GRAY);
+}
+
+#if TELEMETRY_ENABLED
+// One bar per bucket, scaled to the fullest; buckets double from 0.25 ms.
+static void DrawHistogram(const char *label, const TelemetryHistogram *h, int x, int y) {
+    double mean = h->samples ? h->total_ms / h->samples : 0.0;
+    DrawText(TextFormat("%s: mean %.3f ms, max %.3f ms", label, mean, h->max_ms), x, y, 10, DARKGRAY);
+    uint64_t top = 1;
+    for (int i = 0; i < TELEMETRY_BUCKETS; i++) {
+        if (h->counts[i] > top) top = h->counts[i];
+    }
+    for (int i = 0; i < TELEMETRY_BUCKETS; i++) {
+        int height = (int)(30 * h->counts[i] / top);
+        DrawRectangle(x + i * 20, y + 44 - height, 16, height, i < TELEMETRY_BUCKETS - 1 ? GRAY : MAROON);
+    }
+}
+
+static void DrawTelemetryOverlay(void) {
+    TelemetryStats stats;
+    Telemetry_Snapshot(&stats);
+    const TelemetryMove *m = &stats.last_move;
+    int x = GetScreenWidth() - 270;
+    int y = 10;
+    DrawRectangle(x - 10, y - 5, 270, 190, Fade(RAYWHITE, 0.9f));
+    const char *source = m->book ? " (book)" : m->tablebase ? " (tablebase)" : m->endgame ? " (endgame)" : "";
+    DrawText(TextFormat("AI move: %.1f ms%s", m->ms, source), x, y, 10, BLACK);
+    DrawText(TextFormat("nodes %lld (%.2f M/s), depth %d", (long long)m->nodes,
+                        m->ms > 0 ? m->nodes / m->ms / 1000.0 : 0.0, m->depth), x, y + 14, 10, BLACK);
+    DrawText(TextFormat("TT hits %.1f%% of %llu probes", m->tt_probes ? 100.0 * m->tt_hits / m->tt_probes : 0.0,
+                        (unsigned long long)m->tt_probes), x, y + 28, 10, BLACK);
+    DrawText(TextFormat("%llu moves, mean %.1f ms, TT hits %.1f%% overall", (unsigned long long)stats.moves,
+                        stats.moves ? stats.move_ms / stats.moves : 0.0,
+                        stats.tt_probes ? 100.0 * stats.tt_hits / stats.tt_probes : 0.0), x, y + 42, 10, BLACK);
+    DrawHistogram("update", &stats.update, x, y + 64);
+    DrawHistogram("draw", &stats.draw, x, y + 120);
+}
+#endif
+
+// Everything a frame shows besides the board texture, which BoardCache_Sync
+// keeps up to date on its own. Zeroed before filling so padding compares
+// equal.
+typedef struct {
+    GameState state;
+    GameMode mode;
+    int rows, cols;
+    uint64_t board;         // Zobrist hash of the drawn edges
+    int moves;
+    int current_player;
+    int scores[2];
+    int hover_edge;
+    int thinking;           // frame of the "AI thinking" dots, -1 if idle
+    bool turbo;
+    bool overlay;
+    int width, height;
+} FrameKey;
+
+static FrameKey drawn_key;
+static bool drawn;
+
+static void FrameKey_Fill(FrameKey *k) {
+    memset(k, 0, sizeof(*k));
+    k->state = game.state;
+    k->mode = game.mode;
+    k->rows = game.rows;
+    k->cols = game.cols;
+    k->board = game.grid.hash[0];
+    k->moves = game.history.count;
+    k->current_player = game.current_player;
+    k->scores[0] = game.scores[0];
+    k->scores[1] = game.scores[1];
+    k->hover_edge = hover_edge;
+    k->thinking = AIWorker_IsThinking(&ai_worker) ? (int)(GetTime() * 3.0) % 4 : -1;
+    k->turbo = turbo;
+#if TELEMETRY_ENABLED
+    k->overlay = telemetry_overlay;
+#endif
+    k->width = GetScreenWidth();
+    k->height = GetScreenHeight();
+}
+
+bool GameNeedsRedraw(void) {
+    FrameKey key;
+    FrameKey_Fill(&key);
+    return !drawn || memcmp(&key, &drawn_key, sizeof(key)) != 0;
+}
+
+bool GameIsIdle(void) {
+    if (game.state != STATE_PLAYING) return true;
+    // A finished board still needs the frame that shows the result.
+    return !Game_IsOver(&game.grid) && !game.players[game.current_player].is_ai;
+}
+
+void SetTurboMode(bool on) {
+    turbo = on;
+}
+
+// Closes the frame, timing everything drawn since DrawGame began.
+static void EndFrame(void) {
+#if TELEMETRY_ENABLED
+    if (telemetry_overlay) DrawTelemetryOverlay();
+    TELEMETRY_RECORD_FRAME(frame_update_ms, Timer_ElapsedMs(frame_draw_start));
+#endif
+    EndDrawing();
+}
+
 void DrawGame(void) {
+#if TELEMETRY_ENABLED
+    frame_draw_start = Timer_NowNs();
+#endif
+    FrameKey_Fill(&drawn_key);
+    drawn = true;
+    if (game.state != STATE_MENU) {
+        BoardCache_Sync();
+    }
     BeginDrawing();
     ClearBackground(RAYWHITE);
-    
-    // Draw grid
-    for (int r = 0; r <= game.grid.rows; r++) {
-        for (int c = 0; c < game.grid.cols; c++) {
-            int x1 = game.offset_x + c * game.cell_size;
-            int y1 = game.offset_y + r * game.cell_size;
-            int x2 = x1 + game.cell_size;
-            int y2 = y1;
-            
-            if (r < game.grid.rows && Grid_index_h(&game.grid, r, c) < (game.grid.rows + 1) * game.grid.cols) {
-                if (game.grid.h_edges[Grid_index_h(&game.grid, r, c)]) {
-                    DrawLine(x1, y1, x2, y2, BLACK);
-                } else {
-                    DrawLine(x1, y1, x2, y2, LIGHTGRAY);
-                }
-            }
-        }
+
+    if (game.state == STATE_MENU) {
+        DrawMenu();
+        EndFrame();
+        return;
     }
     
-    for (int r = 0; r < game.grid.rows; r++) {
-        for (int c = 0; c <= game.grid.cols; c++) {
-            int x1 = game.offset_x + c * game.cell_size;
-            int y1 = game.offset_y + r * game.cell_size;
-            int x2 = x1;
-            int y2 = y1 + game.cell_size;
-            
-            if (c < game.grid.cols && Grid_index_v(&game.grid, r, c) < game.grid.rows * (game.grid.cols + 1)) {
-                if (game.grid.v_edges[Grid_index_v(&game.grid, r, c)]) {
-                    DrawLine(x1, y1, x2, y2, BLACK);
-                } else {
-                    DrawLine(x1, y1, x2, y2, LIGHTGRAY);
-                }
-            }
-        }
-    }
+    // Render textures are stored bottom-up, hence the negative height.
+    BoardCache *bc = &board_cache;
+    DrawTextureRec(bc->target.texture,
+                   (Rectangle){ 0, 0, (float)bc->target.texture.width, (float)-bc->target.texture.height },
+                   (Vector2){ (float)(game.offset_x - BOARD_PAD), (float)(game.offset_y - BOARD_PAD) }, WHITE);
     
-    // Draw dots
-    for (int r = 0; r <= game.grid.rows; r++) {
-        for (int c = 0; c <= game.grid.cols; c++) {
-            int x = game.offset_x + c * game.cell_size;
-            int y = game.offset_y + r * game.cell_size;
-            DrawCircle(x, y, 3, BLACK);
-        }
-    }
-    
-    // Draw boxes
-    for (int r = 0; r < game.grid.rows; r++) {
-        for (int c = 0; c < game.grid.cols; c++) {
-            if (game.grid.owners[r * game.grid.cols + c] != -1) {
-                int x = game.offset_x + c * game.cell_size + game.cell_size / 2;
-                int y = game.offset_y + r * game.cell_size + game.cell_size / 2;
-                Color color = game.players[game.grid.owners[r * game.grid.cols + c]].color;
-                DrawRectangle(x - game.cell_size / 2 + 2, y - game.cell_size / 2 + 2, 
-                             game.cell_size - 4, game.cell_size - 4, 
-                             Fade(color, 0.3f));
-            }
-        }
+    if (hover_edge >= 0) {
+        bool horizontal;
+        int r, c;
+        Grid_edge_coords(&game.grid, hover_edge, &horizontal, &r, &c);
+        int x = game.offset_x + c * game.cell_size;
+        int y = game.offset_y + r * game.cell_size;
+        DrawLine(x, y, x + (horizontal ? game.cell_size : 0), y + (horizontal ? 0 : game.cell_size),
+                 Fade(PlayerColor(game.current_player), 0.5f));
     }
     
     // Draw scores
@@ -151,7 +564,15 @@ void DrawGame(void) {
     // Draw current player indicator
     if (game.state == STATE_PLAYING) {
         const char *player_text = TextFormat("Current Player: %d", game.current_player + 1);
-        DrawText(player_text, 10, 70, 20, game.players[game.current_player].color);
+        DrawText(player_text, 10, 70, 20, PlayerColor(game.current_player));
+        if (AIWorker_IsThinking(&ai_worker)) {
+            int dots = (int)(GetTime() * 3.0) % 4;
+            DrawText(TextFormat("AI thinking%.*s", dots, "..."),
+                     10 + MeasureText(player_text, 20) + 20, 70, 20, DARKGRAY);
+        }
+        if (game.mode == MODE_MVM) {
+            DrawText(TextFormat("Turbo %s (T)", turbo ? "on" : "off"), 250, 10, 20, turbo ? MAROON : GRAY);
+        }
     }
     
     if (game.state == STATE_GAME_OVER) {
@@ -161,24 +582,22 @@ void DrawGame(void) {
             DrawText("Game Over: It's a tie!", 250, 250, 30, BLACK);
         } else {
             DrawText(TextFormat("Game Over: Player %d wins!", winner + 1), 250, 250, 30, 
-                    game.players[winner].color);
-        }
-        DrawText("Press R to restart", 280, 300, 20, DARKGRAY);
-        
-        // Check for restart
-        if (IsKeyPressed(KEY_R)) {
-            ResetGrid();
+                    PlayerColor(winner));
         }
+        DrawText("Press R to restart, M for the menu", 220, 300, 20, DARKGRAY);
     }
     
-    EndDrawing();
+    EndFrame();
 }
 
 void ResetGrid(void) {
+    AIWorker_Cancel(&ai_worker);
     Grid_Free(&game.grid);
-    Grid_Init(&game.grid, 5, 5);
-    game.scores[0] = 0;
-    game.scores[1] = 0;
+    MoveStack_Free(&game.history);
+    Grid_Init(&game.grid, game.rows, game.cols);
+    MoveStack_Init(&game.history, game.grid.num_edges);
+    LayoutBoard();
+    Players_SyncScores(&game);
     game.current_player = 0;
     game.state = STATE_PLAYING;
 }
\ No newline at end of file
@@ -1,22 +1,151 @@
 #include "grid.h"
+#include "chain.h"
+#include "classify.h"
+#include "gridkernels.h"
 #include <stdlib.h>
 #include <string.h>
 
+// splitmix64 of the board size and the edge index (-1 for the empty board),
+// so keys agree across runs and processes but not across board sizes.
+static uint64_t Grid_zobrist_key(const Grid *g, int edge) {
+    uint64_t seed = (uint64_t)g->rows << 40 | (uint64_t)g->cols << 20 | (uint64_t)(edge + 1);
+    uint64_t z = seed * 0x9E3779B97F4A7C15ull + 0x632BE59BD9B4E019ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static void Grid_clear_hash(Grid *g) {
+    uint64_t empty = Grid_zobrist_key(g, -1);
+    for (int s = 0; s < GRID_MAX_SYMMETRIES; s++) g->hash[s] = empty;
+}
+
+// Maps doubled edge-midpoint coordinates (y, x) on a board of height h = 2 *
+// rows and width w = 2 * cols through symmetry `sym`.
+static void Grid_transform(int sym, int h, int w, int *y, int *x) {
+    int oy = *y, ox = *x;
+    switch (sym) {
+        case 0: break;
+        case 1: *y = h - oy; *x = w - ox; break;
+        case 2: *y = h - oy; break;
+        case 3: *x = w - ox; break;
+        case 4: *y = ox; *x = oy; break;
+        case 5: *y = w - ox; *x = h - oy; break;
+        case 6: *y = ox; *x = h - oy; break;
+        case 7: *y = w - ox; *x = oy; break;
+    }
+}
+
+static void Grid_build_symmetries(Grid *g) {
+    for (int s = 0; s < g->num_syms; s++) {
+        for (int e = 0; e < g->num_edges; e++) {
+            bool horizontal;
+            int r, c, y, x;
+            Grid_edge_coords(g, e, &horizontal, &r, &c);
+            y = horizontal ? 2 * r : 2 * r + 1;
+            x = horizontal ? 2 * c + 1 : 2 * c;
+            Grid_transform(s, 2 * g->rows, 2 * g->cols, &y, &x);
+            int image = (y & 1) ? Grid_index_v(g, y / 2, x / 2) : Grid_index_h(g, y / 2, x / 2);
+            g->sym_edges[s * g->num_edges + e] = image;
+            g->sym_keys[s * g->num_edges + e] = Grid_zobrist_key(g, image);
+        }
+    }
+    Grid_clear_hash(g);
+}
+
+// Takes `bytes` from a block being laid out, keeping every piece 8-byte
+// aligned. With a NULL base it only measures.
+static void *Grid_carve(uint8_t *base, size_t *offset, size_t bytes) {
+    void *p = base ? base + *offset : NULL;
+    *offset += (bytes + 7) & ~(size_t)7;
+    return p;
+}
+
+// Points the arrays of `g` into `base`. The position comes first, so it can
+// be copied as one prefix of state_size bytes; the per-size tables after it
+// never change once built.
+static void Grid_layout(Grid *g, uint8_t *base) {
+    size_t offset = 0;
+    size_t edge_bytes = g->edge_words * sizeof(uint64_t);
+    size_t box_bytes = g->box_words * sizeof(uint64_t);
+    size_t sym_entries = (size_t)g->num_syms * g->num_edges;
+    g->edges = Grid_carve(base, &offset, edge_bytes);
+    g->capture_moves = Grid_carve(base, &offset, edge_bytes);
+    g->safe_moves = Grid_carve(base, &offset, edge_bytes);
+    g->owned[0] = Grid_carve(base, &offset, box_bytes);
+    g->owned[1] = Grid_carve(base, &offset, box_bytes);
+    g->sides = Grid_carve(base, &offset, g->num_boxes * sizeof(uint8_t));
+    g->state_size = offset;
+    g->sym_keys = Grid_carve(base, &offset, sym_entries * sizeof(uint64_t));
+    g->sym_edges = Grid_carve(base, &offset, sym_entries * sizeof(int));
+    g->edge_boxes = Grid_carve(base, &offset, 2 * g->num_edges * sizeof(int));
+    g->block_size = offset;
+}
+
 void Grid_Init(Grid *g, int rows, int cols) {
     g->rows = rows;
     g->cols = cols;
-    g->h_edges = calloc((rows + 1) * cols, sizeof(bool));
-    g->v_edges = calloc(rows * (cols + 1), sizeof(bool));
-    g->owners = malloc(rows * cols * sizeof(int));
-    for (int i = 0; i < rows * cols; i++) {
-        g->owners[i] = -1;
+    g->num_h = (rows + 1) * cols;
+    g->num_edges = g->num_h + rows * (cols + 1);
+    g->num_boxes = rows * cols;
+    g->edge_words = BITSET_WORDS(g->num_edges);
+    g->box_words = BITSET_WORDS(g->num_boxes);
+    g->num_syms = rows == cols ? 8 : 4;
+    Grid_layout(g, NULL);
+    g->block = malloc(g->block_size);
+    Grid_layout(g, g->block);
+    memset(g->block, 0, g->state_size);
+    g->claimed[0] = g->claimed[1] = 0;
+    g->claimed_total = 0;
+    g->num_open = g->num_edges;
+    g->num_capture = 0;
+    g->num_safe = g->num_edges;
+    // On an empty board every edge is safe.
+    for (int w = 0; w < g->edge_words; w++) {
+        g->safe_moves[w] = w == g->edge_words - 1 ? Bitset_TailMask(g->num_edges) : ~(uint64_t)0;
     }
+    for (int e = 0; e < g->num_edges; e++) {
+        bool horizontal;
+        int r, c;
+        Grid_edge_coords(g, e, &horizontal, &r, &c);
+        if (horizontal) {
+            g->edge_boxes[2 * e] = r > 0 ? (r - 1) * cols + c : -1;
+            g->edge_boxes[2 * e + 1] = r < rows ? r * cols + c : -1;
+        } else {
+            g->edge_boxes[2 * e] = c > 0 ? r * cols + c - 1 : -1;
+            g->edge_boxes[2 * e + 1] = c < cols ? r * cols + c : -1;
+        }
+    }
+    Grid_build_symmetries(g);
+    g->chains = NULL;
+    g->kernels = GridKernels_For(rows, cols);
 }
 
 void Grid_Free(Grid *g) {
-    free(g->h_edges);
-    free(g->v_edges);
-    free(g->owners);
+    free(g->block);
+    g->block = NULL;
+}
+
+void Grid_Clone(Grid *dst, const Grid *src) {
+    *dst = *src;
+    dst->block = malloc(src->block_size);
+    memcpy(dst->block, src->block, src->block_size);
+    Grid_layout(dst, dst->block);
+    dst->chains = NULL;
+}
+
+// Copies the position of `src` into `dst`, which must already be initialised
+// with the same dimensions. Any chain set on `dst` is left untouched, so it
+// should not have one attached.
+void Grid_CopyInto(Grid *dst, const Grid *src) {
+    memcpy(dst->block, src->block, src->state_size);
+    memcpy(dst->hash, src->hash, sizeof(src->hash));
+    dst->claimed[0] = src->claimed[0];
+    dst->claimed[1] = src->claimed[1];
+    dst->claimed_total = src->claimed_total;
+    dst->num_open = src->num_open;
+    dst->num_capture = src->num_capture;
+    dst->num_safe = src->num_safe;
 }
 
 int Grid_index_h(const Grid *g, int r, int c) {
@@ -24,31 +153,169 @@ int Grid_index_h(const Grid *g, int r, int c) {
 }
 
 int Grid_index_v(const Grid *g, int r, int c) {
-    return r * (g->cols + 1) + c;
+    return g->num_h + r * (g->cols + 1) + c;
 }
 
-bool Grid_set_horizontal(Grid *g, int r, int c) {
-    int ind = Grid_index_h(g, r, c);
-    if (g->h_edges[ind]) return false;
-    g->h_edges[ind] = true;
+static void Grid_toggle_hash(Grid *g, int edge) {
+    const uint64_t *keys = g->sym_keys + edge;
+    for (int s = 0; s < g->num_syms; s++) {
+        g->hash[s] ^= keys[s * g->num_edges];
+    }
+}
+
+static void Grid_classify_edge(Grid *g, int edge) {
+    g->num_capture -= Bitset_Test(g->capture_moves, edge);
+    g->num_safe -= Bitset_Test(g->safe_moves, edge);
+    Bitset_Clear(g->capture_moves, edge);
+    Bitset_Clear(g->safe_moves, edge);
+    if (Bitset_Test(g->edges, edge)) return;
+
+    const int *boxes = Grid_edge_boxes(g, edge);
+    int most = 0;
+    for (int i = 0; i < 2; i++) {
+        if (boxes[i] >= 0 && g->sides[boxes[i]] > most) most = g->sides[boxes[i]];
+    }
+    if (most == 3) {
+        Bitset_Set(g->capture_moves, edge);
+        g->num_capture++;
+    } else if (most <= 1) {
+        Bitset_Set(g->safe_moves, edge);
+        g->num_safe++;
+    }
+}
+
+// The class of an edge depends only on the two boxes beside it, so a change
+// to one box's side count only touches that box's four edges.
+static void Grid_box_changed(Grid *g, int box) {
+    int r = box / g->cols;
+    int c = box % g->cols;
+    int top = r * g->cols + c;
+    int left = g->num_h + r * (g->cols + 1) + c;
+    Grid_classify_edge(g, top);
+    Grid_classify_edge(g, top + g->cols);
+    Grid_classify_edge(g, left);
+    Grid_classify_edge(g, left + 1);
+}
+
+bool Grid_set_edge(Grid *g, int edge) {
+    if (Bitset_Test(g->edges, edge)) return false;
+    Bitset_Set(g->edges, edge);
+    g->num_open--;
+    Grid_toggle_hash(g, edge);
+    const int *boxes = Grid_edge_boxes(g, edge);
+    for (int i = 0; i < 2; i++) {
+        if (boxes[i] < 0) continue;
+        g->sides[boxes[i]]++;
+        Grid_box_changed(g, boxes[i]);
+    }
+    if (g->chains) Chains_EdgeChanged(g->chains, g, edge);
     return true;
 }
 
+void Grid_clear_edge(Grid *g, int edge) {
+    if (!Bitset_Test(g->edges, edge)) return;
+    Bitset_Clear(g->edges, edge);
+    g->num_open++;
+    Grid_toggle_hash(g, edge);
+    const int *boxes = Grid_edge_boxes(g, edge);
+    for (int i = 0; i < 2; i++) {
+        if (boxes[i] < 0) continue;
+        g->sides[boxes[i]]--;
+        Grid_box_changed(g, boxes[i]);
+    }
+    if (g->chains) Chains_EdgeChanged(g->chains, g, edge);
+}
+
+void Grid_SetPosition(Grid *g, const uint64_t *edges, const uint64_t *owned1) {
+    memcpy(g->edges, edges, g->edge_words * sizeof(uint64_t));
+    g->edges[g->edge_words - 1] &= Bitset_TailMask(g->num_edges);
+    Grid_clear_hash(g);
+    for (int w = 0; w < g->edge_words; w++) {
+        for (uint64_t word = g->edges[w]; word; word &= word - 1) {
+            Grid_toggle_hash(g, w * 64 + Bitset_Ctz(word));
+        }
+    }
+    Classify_Grid(g);
+
+    memset(g->owned[0], 0, g->box_words * sizeof(uint64_t));
+    memset(g->owned[1], 0, g->box_words * sizeof(uint64_t));
+    g->claimed[0] = g->claimed[1] = 0;
+    for (int b = 0; b < g->num_boxes; b++) {
+        if (g->sides[b] != 4) continue;
+        int player = owned1 && Bitset_Test(owned1, b) ? 1 : 0;
+        Bitset_Set(g->owned[player], b);
+        g->claimed[player]++;
+    }
+    g->claimed_total = g->claimed[0] + g->claimed[1];
+}
+
+bool Grid_set_horizontal(Grid *g, int r, int c) {
+    return Grid_set_edge(g, Grid_index_h(g, r, c));
+}
+
 bool Grid_set_vertical(Grid *g, int r, int c) {
-    int ind = Grid_index_v(g, r, c);
-    if (g->v_edges[ind]) return false;
-    g->v_edges[ind] = true;
-    return true;
+    return Grid_set_edge(g, Grid_index_v(g, r, c));
+}
+
+void Grid_edge_coords(const Grid *g, int edge, bool *horizontal, int *r, int *c) {
+    if (edge < g->num_h) {
+        *horizontal = true;
+        *r = edge / g->cols;
+        *c = edge % g->cols;
+    } else {
+        edge -= g->num_h;
+        *horizontal = false;
+        *r = edge / (g->cols + 1);
+        *c = edge % (g->cols + 1);
+    }
 }
 
 int Grid_claimed_box(const Grid *g, int r, int c) {
-    int h_top = Grid_index_h(g, r, c);
-    int h_bot = Grid_index_h(g, r + 1, c);
-    int v_left = Grid_index_v(g, r, c);
-    int v_right = Grid_index_v(g, r, c + 1);
+    return g->sides[r * g->cols + c] == 4;
+}
+
+int Grid_count_moves(const Grid *g, MoveClass cls) {
+    switch (cls) {
+        case MOVES_CAPTURE: return g->num_capture;
+        case MOVES_SAFE: return g->num_safe;
+        case MOVES_SACRIFICE: return g->num_open - g->num_capture - g->num_safe;
+        default: return g->num_open;
+    }
+}
+
+// The k-th (0-based) edge of class `cls`, or -1.
+int Grid_nth_move(const Grid *g, MoveClass cls, int k) {
+    for (int w = 0; w < g->edge_words; w++) {
+        uint64_t word = Grid_moves_word(g, cls, w);
+        int n = __builtin_popcountll(word);
+        if (k >= n) {
+            k -= n;
+            continue;
+        }
+        while (k-- > 0) word &= word - 1;
+        return w * 64 + Bitset_Ctz(word);
+    }
+    return -1;
+}
 
-    if (g->h_edges[h_top] && g->h_edges[h_bot] && g->v_edges[v_left] && g->v_edges[v_right]) {
-        return 1;
+// Smallest of the symmetric hashes, so all images of a position share one
+// key. `sym` receives the symmetry that maps this board onto that image.
+uint64_t Grid_canonical_hash(const Grid *g, int *sym) {
+    uint64_t best = g->hash[0];
+    int best_sym = 0;
+    for (int s = 1; s < g->num_syms; s++) {
+        if (g->hash[s] < best) {
+            best = g->hash[s];
+            best_sym = s;
+        }
     }
-    return 0;
-}
\ No newline at end of file
+    if (sym) *sym = best_sym;
+    return best;
+}
+
+int Grid_sym_inverse(int sym) {
+    // Everything but the two quarter turns is its own inverse.
+    if (sym == 6) return 7;
+    if (sym == 7) return 6;
+    return sym;
+}
@@ -0,0 +1,170 @@
+#include "gridkernels.h"
+#include "chain.h"
+
+// Every kernel body takes the board size as arguments and is forced inline,
+// so each wrapper below that passes constants gets its own folded copy. The
+// generic wrappers pass the grid's own fields.
+#define KERNEL static inline __attribute__((always_inline))
+
+#define K_NUM_H(R, C) (((R) + 1) * (C))
+#define K_NUM_EDGES(R, C) (K_NUM_H(R, C) + (R) * ((C) + 1))
+
+KERNEL void Kernel_ToggleHash(Grid *g, int edge, int R, int C) {
+    const int edges = K_NUM_EDGES(R, C);
+    const int syms = R == C ? 8 : 4;
+    const uint64_t *keys = g->sym_keys + edge;
+    for (int s = 0; s < syms; s++) {
+        g->hash[s] ^= keys[s * edges];
+    }
+}
+
+// Same rule as Grid_classify_edge.
+KERNEL void Kernel_ClassifyEdge(Grid *g, int edge) {
+    g->num_capture -= Bitset_Test(g->capture_moves, edge);
+    g->num_safe -= Bitset_Test(g->safe_moves, edge);
+    Bitset_Clear(g->capture_moves, edge);
+    Bitset_Clear(g->safe_moves, edge);
+    if (Bitset_Test(g->edges, edge)) return;
+
+    const int *boxes = Grid_edge_boxes(g, edge);
+    int a = boxes[0] >= 0 ? g->sides[boxes[0]] : 0;
+    int b = boxes[1] >= 0 ? g->sides[boxes[1]] : 0;
+    int most = a > b ? a : b;
+    if (most == 3) {
+        Bitset_Set(g->capture_moves, edge);
+        g->num_capture++;
+    } else if (most <= 1) {
+        Bitset_Set(g->safe_moves, edge);
+        g->num_safe++;
+    }
+}
+
+KERNEL void Kernel_BoxChanged(Grid *g, int box, int R, int C) {
+    int r = box / C;
+    int c = box % C;
+    int top = r * C + c;
+    int left = K_NUM_H(R, C) + r * (C + 1) + c;
+    Kernel_ClassifyEdge(g, top);
+    Kernel_ClassifyEdge(g, top + C);
+    Kernel_ClassifyEdge(g, left);
+    Kernel_ClassifyEdge(g, left + 1);
+}
+
+KERNEL int Kernel_Play(Grid *g, int edge, int player, int R, int C) {
+    Bitset_Set(g->edges, edge);
+    g->num_open--;
+    Kernel_ToggleHash(g, edge, R, C);
+    const int *boxes = Grid_edge_boxes(g, edge);
+    int claimed = 0;
+    for (int i = 0; i < 2; i++) {
+        int b = boxes[i];
+        if (b < 0) continue;
+        if (++g->sides[b] == 4 && !Bitset_Test(g->owned[0], b) && !Bitset_Test(g->owned[1], b)) {
+            Bitset_Set(g->owned[player], b);
+            claimed++;
+        }
+        Kernel_BoxChanged(g, b, R, C);
+    }
+    g->claimed[player] += claimed;
+    g->claimed_total += claimed;
+    if (g->chains) Chains_EdgeChanged(g->chains, g, edge);
+    return claimed;
+}
+
+KERNEL void Kernel_Unplay(Grid *g, int edge, int R, int C) {
+    Bitset_Clear(g->edges, edge);
+    g->num_open++;
+    Kernel_ToggleHash(g, edge, R, C);
+    const int *boxes = Grid_edge_boxes(g, edge);
+    for (int i = 0; i < 2; i++) {
+        int b = boxes[i];
+        if (b < 0) continue;
+        // A complete box beside the edge was completed by it.
+        for (int p = 0; p < 2; p++) {
+            if (!Bitset_Test(g->owned[p], b)) continue;
+            Bitset_Clear(g->owned[p], b);
+            g->claimed[p]--;
+            g->claimed_total--;
+        }
+        g->sides[b]--;
+        Kernel_BoxChanged(g, b, R, C);
+    }
+    if (g->chains) Chains_EdgeChanged(g->chains, g, edge);
+}
+
+KERNEL int Kernel_CollectClass(const Grid *g, MoveClass cls, int *moves, int skip, int R, int C) {
+    const int words = BITSET_WORDS(K_NUM_EDGES(R, C));
+    int n = 0;
+    for (int w = 0; w < words; w++) {
+        uint64_t word = Grid_moves_word(g, cls, w);
+        while (word) {
+            int edge = w * 64 + Bitset_Ctz(word);
+            word &= word - 1;
+            moves[n] = edge;
+            n += edge != skip;
+        }
+    }
+    return n;
+}
+
+// One copy of the loop per class, so the class test leaves the loop.
+KERNEL int Kernel_Collect(const Grid *g, MoveClass cls, int *moves, int skip, int R, int C) {
+    switch (cls) {
+        case MOVES_CAPTURE: return Kernel_CollectClass(g, MOVES_CAPTURE, moves, skip, R, C);
+        case MOVES_SAFE: return Kernel_CollectClass(g, MOVES_SAFE, moves, skip, R, C);
+        case MOVES_SACRIFICE: return Kernel_CollectClass(g, MOVES_SACRIFICE, moves, skip, R, C);
+        default: return Kernel_CollectClass(g, MOVES_OPEN, moves, skip, R, C);
+    }
+}
+
+KERNEL int Kernel_Capturable(const Grid *g, int R, int C) {
+    const int words = BITSET_WORDS(K_NUM_EDGES(R, C));
+    int boxes = 0;
+    for (int w = 0; w < words; w++) {
+        for (uint64_t word = g->capture_moves[w]; word; word &= word - 1) {
+            const int *b = Grid_edge_boxes(g, w * 64 + Bitset_Ctz(word));
+            boxes += (b[0] >= 0 && g->sides[b[0]] == 3) + (b[1] >= 0 && g->sides[b[1]] == 3);
+        }
+    }
+    return boxes;
+}
+
+#define GRID_KERNELS(NAME, R, C)                                                        \
+    static int Play_##NAME(Grid *g, int edge, int player) {                             \
+        return Kernel_Play(g, edge, player, R, C);                                      \
+    }                                                                                   \
+    static void Unplay_##NAME(Grid *g, int edge) {                                      \
+        Kernel_Unplay(g, edge, R, C);                                                   \
+    }                                                                                   \
+    static int Collect_##NAME(const Grid *g, MoveClass cls, int *moves, int skip) {     \
+        return Kernel_Collect(g, cls, moves, skip, R, C);                               \
+    }                                                                                   \
+    static int Capturable_##NAME(const Grid *g) {                                       \
+        return Kernel_Capturable(g, R, C);                                              \
+    }
+
+GRID_KERNELS(3x3, 3, 3)
+GRID_KERNELS(4x4, 4, 4)
+GRID_KERNELS(5x5, 5, 5)
+GRID_KERNELS(6x6, 6, 6)
+GRID_KERNELS(8x8, 8, 8)
+GRID_KERNELS(Generic, g->rows, g->cols)
+
+#define GRID_KERNEL_TABLE(NAME, R, C) { R, C, Play_##NAME, Unplay_##NAME, Collect_##NAME, Capturable_##NAME }
+
+static const GridKernels grid_kernels[] = {
+    GRID_KERNEL_TABLE(3x3, 3, 3),
+    GRID_KERNEL_TABLE(4x4, 4, 4),
+    GRID_KERNEL_TABLE(5x5, 5, 5),
+    GRID_KERNEL_TABLE(6x6, 6, 6),
+    GRID_KERNEL_TABLE(8x8, 8, 8),
+};
+
+static const GridKernels grid_kernels_generic = GRID_KERNEL_TABLE(Generic, 0, 0);
+
+const GridKernels *GridKernels_For(int rows, int cols) {
+    for (int i = 0; i < (int)(sizeof(grid_kernels) / sizeof(grid_kernels[0])); i++) {
+        if (grid_kernels[i].rows == rows && grid_kernels[i].cols == cols) return &grid_kernels[i];
+    }
+    return &grid_kernels_generic;
+}
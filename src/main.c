@@ -1,17 +1,117 @@
 #include "raylib.h"
+#include "engine.h"
 #include "game.h"
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TARGET_FPS 60
+
+static void Usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--size N | --rows N --cols N] [--mode pvp|pvm|mvm|solo]\n"
+            "          [--record FILE] [--telemetry FILE] [--turbo]\n"
+            "       %s --engine\n"
+            "boards go up to %dx%d; without a size the game opens on the menu\n"
+            "--turbo plays AI vs AI games without waiting for each frame (T toggles it)\n"
+            "--engine speaks the text protocol in engine.h on stdin/stdout\n",
+            prog, prog, GAME_MAX_SIZE, GAME_MAX_SIZE);
+}
+
+static bool ParseMode(const char *name, GameMode *mode) {
+    static const char *names[] = { "pvp", "pvm", "mvm", "solo" };
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *mode = (GameMode)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv) {
+    GameMode mode = MODE_SOLO;
+    int rows = GAME_DEFAULT_SIZE;
+    int cols = GAME_DEFAULT_SIZE;
+    bool sized = false;
+    bool turbo = false;
+    const char *record_path = NULL;
+
+    // No window in engine mode: the protocol is all there is.
+    if (argc == 2 && strcmp(argv[1], "--engine") == 0) return Engine_Run(stdin, stdout);
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--turbo") == 0) {
+            turbo = true;
+            continue;
+        }
+        if (strcmp(argv[i], "--size") == 0 && value) {
+            rows = cols = atoi(value);
+            sized = true;
+        } else if (strcmp(argv[i], "--rows") == 0 && value) {
+            rows = atoi(value);
+            sized = true;
+        } else if (strcmp(argv[i], "--cols") == 0 && value) {
+            cols = atoi(value);
+            sized = true;
+        } else if (strcmp(argv[i], "--mode") == 0 && value) {
+            if (!ParseMode(value, &mode)) {
+                Usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--record") == 0 && value) {
+            record_path = value;
+        } else if (strcmp(argv[i], "--telemetry") == 0 && value) {
+#if TELEMETRY_ENABLED
+            if (!Telemetry_OpenSink(value)) {
+                fprintf(stderr, "cannot write telemetry to '%s'\n", value);
+            }
+#else
+            fprintf(stderr, "built without telemetry; ignoring --telemetry\n");
+#endif
+        } else {
+            Usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    if (rows < 1 || cols < 1 || rows > GAME_MAX_SIZE || cols > GAME_MAX_SIZE) {
+        Usage(argv[0]);
+        return 1;
+    }
 
-int main(void) {
     InitWindow(800, 600, "Dots and Boxes");
-    SetTargetFPS(60);
+    SetTargetFPS(TARGET_FPS);
 
-    InitGame(MODE_SOLO);
+    InitGame(mode, rows, cols);
+    SetTurboMode(turbo);
+    if (!sized) ShowMenu();
+    if (record_path && !StartRecording(record_path)) {
+        fprintf(stderr, "cannot append game records to '%s'\n", record_path);
+    }
 
     while (!WindowShouldClose()) {
         UpdateGame();
+        // Skip frames that would look the same as the last. While nothing
+        // moves on its own, wait for input; while an AI thinks, sleep out the
+        // frame, since only its move or the thinking dots change the picture.
+        bool idle = GameIsIdle();
+        if (idle) EnableEventWaiting();
+        else DisableEventWaiting();
+        if (!GameNeedsRedraw()) {
+            if (!idle) WaitTime(1.0 / TARGET_FPS);
+            PollInputEvents();
+            continue;
+        }
         DrawGame();
     }
 
+    CloseGame();
     CloseWindow();
+#if TELEMETRY_ENABLED
+    Telemetry_Close();
+#endif
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,296 @@
+#include "mcts.h"
+#include "ai.h"
+#include "player.h"
+#include "rng.h"
+#include "timer.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define MCTS_LEAF 0
+#define MCTS_EXPANDING 1    // claimed by one thread, or left so when the pool ran out
+#define MCTS_EXPANDED 2
+
+// A leaf is expanded on its second visit; the first only runs a playout.
+#define MCTS_EXPAND_VISITS 2
+#define MCTS_DEFAULT_PLAYOUTS 10000
+// A playout is worth at most this many units per box on the board.
+#define MCTS_REWARD_UNITS 4
+
+typedef struct {
+    Mcts *mcts;
+    const Grid *root;
+    int root_player;
+    const MctsLimits *limits;
+    int64_t max_playouts;
+    uint64_t seed;
+    uint64_t deadline_ns;
+    int32_t next_node;
+    int64_t playouts;
+    int32_t stop;
+} MctsJob;
+
+static void Mcts_ResetNode(MctsNode *node, int move, int player) {
+    node->move = move;
+    node->first_child = -1;
+    node->num_children = 0;
+    node->state = MCTS_LEAF;
+    node->player = player;
+    node->visits = 0;
+    node->value = 0;
+}
+
+// Whether `edge` declines the last boxes on offer (double-dealing): it is
+// drawn on a two-sided box whose only other undrawn edge completes a box, so
+// the opponent can take both with one move and must then move again.
+static bool Mcts_IsDecline(const Grid *g, int edge) {
+    const int *boxes = Grid_edge_boxes(g, edge);
+    for (int i = 0; i < 2; i++) {
+        int box = boxes[i];
+        if (box < 0 || g->sides[box] != 2) continue;
+        int r = box / g->cols;
+        int c = box % g->cols;
+        int top = r * g->cols + c;
+        int left = g->num_h + r * (g->cols + 1) + c;
+        int edges[4] = { top, top + g->cols, left, left + 1 };
+        for (int k = 0; k < 4; k++) {
+            if (edges[k] == edge || Grid_has_edge(g, edges[k])) continue;
+            if (Bitset_Test(g->capture_moves, edges[k])) return true;
+        }
+    }
+    return false;
+}
+
+// Word `w` of the moves worth a child in class `cls`: sacrifices only count
+// as declines while a capture is on offer.
+static uint64_t Mcts_MovesWord(const Grid *g, MoveClass cls, int w, bool captures) {
+    uint64_t word = Grid_moves_word(g, cls, w);
+    if (cls != MOVES_SACRIFICE || !captures) return word;
+    uint64_t declines = 0;
+    while (word) {
+        int edge = w * 64 + Bitset_Ctz(word);
+        if (Mcts_IsDecline(g, edge)) declines |= word & -word;
+        word &= word - 1;
+    }
+    return declines;
+}
+
+// Creates the children of `index`, whose side to move is `player`. Returns
+// true if the node has children afterwards.
+static bool Mcts_Expand(MctsJob *job, int index, const Grid *g, int player) {
+    MctsNode *nodes = job->mcts->nodes;
+    int32_t expected = MCTS_LEAF;
+    if (!__atomic_compare_exchange_n(&nodes[index].state, &expected, MCTS_EXPANDING, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return expected == MCTS_EXPANDED;
+    }
+
+    // While a safe move is left, giving boxes away is never worth a visit and
+    // neither is declining one: take it and play the safe move after. Once
+    // the safe moves run out, a box on offer is still taken unless declining
+    // it (double-dealing) keeps control; only with nothing to take do the
+    // sacrifices join the tree. Expanding every sacrifice next to a capture
+    // lets UCT noise pick one over the capture at small budgets.
+    MoveClass order[2];
+    int classes = 0;
+    bool captures = Grid_count_moves(g, MOVES_CAPTURE) > 0;
+    if (Grid_count_moves(g, MOVES_SAFE) > 0) {
+        order[classes++] = captures ? MOVES_CAPTURE : MOVES_SAFE;
+    } else {
+        order[classes++] = MOVES_CAPTURE;
+        order[classes++] = MOVES_SACRIFICE;
+    }
+    int count = 0;
+    for (int k = 0; k < classes; k++) {
+        for (int w = 0; w < g->edge_words; w++) {
+            count += __builtin_popcountll(Mcts_MovesWord(g, order[k], w, captures));
+        }
+    }
+    int first = __atomic_fetch_add(&job->next_node, count, __ATOMIC_RELAXED);
+    if (count == 0 || first + count > job->mcts->capacity) return false;
+
+    int n = 0;
+    for (int k = 0; k < classes; k++) {
+        for (int w = 0; w < g->edge_words; w++) {
+            uint64_t word = Mcts_MovesWord(g, order[k], w, captures);
+            while (word) {
+                Mcts_ResetNode(&nodes[first + n++], w * 64 + Bitset_Ctz(word), player);
+                word &= word - 1;
+            }
+        }
+    }
+    nodes[index].first_child = first;
+    nodes[index].num_children = count;
+    __atomic_store_n(&nodes[index].state, MCTS_EXPANDED, __ATOMIC_RELEASE);
+    return true;
+}
+
+static int Mcts_Select(MctsJob *job, int index) {
+    MctsNode *nodes = job->mcts->nodes;
+    MctsNode *parent = &nodes[index];
+    int parent_visits = __atomic_load_n(&parent->visits, __ATOMIC_RELAXED);
+    double log_n = log(parent_visits > 1 ? (double)parent_visits : 1.0);
+    double c = job->limits->exploration;
+    double scale = 1.0 / (MCTS_REWARD_UNITS * job->root->num_boxes);
+
+    int best = parent->first_child;
+    double best_score = -1.0;
+    for (int i = 0; i < parent->num_children; i++) {
+        int child = parent->first_child + i;
+        int visits = __atomic_load_n(&nodes[child].visits, __ATOMIC_RELAXED);
+        if (visits == 0) return child;
+        int64_t value = __atomic_load_n(&nodes[child].value, __ATOMIC_RELAXED);
+        double score = value * scale / visits + c * sqrt(log_n / visits);
+        if (score > best_score) {
+            best_score = score;
+            best = child;
+        }
+    }
+    return best;
+}
+
+static void Mcts_Playout(MctsJob *job, Grid *g, Rng *rng, int *path, MoveStack *played) {
+    MctsNode *nodes = job->mcts->nodes;
+    int depth = 0;
+    int player = job->root_player;
+    int index = 0;
+
+    // Every visit counts as a loss until its result is backed up (virtual
+    // loss), which spreads concurrent threads over different lines.
+    path[depth++] = 0;
+    __atomic_add_fetch(&nodes[0].visits, 1, __ATOMIC_RELAXED);
+    for (;;) {
+        int state = __atomic_load_n(&nodes[index].state, __ATOMIC_ACQUIRE);
+        if (state != MCTS_EXPANDED) {
+            if (state != MCTS_LEAF || Game_IsOver(g)) break;
+            if (__atomic_load_n(&nodes[index].visits, __ATOMIC_RELAXED) < MCTS_EXPAND_VISITS) break;
+            if (!Mcts_Expand(job, index, g, player)) break;
+        }
+        int child = Mcts_Select(job, index);
+        __atomic_add_fetch(&nodes[child].visits, 1, __ATOMIC_RELAXED);
+        int claimed = MoveStack_Make(played, g, nodes[child].move, player);
+        if (Player_ShouldSwitch(claimed)) player = 1 - player;
+        index = child;
+        path[depth++] = child;
+    }
+
+    while (!Game_IsOver(g)) {
+        int edge = AI_PolicyMove(rng, g, (AIDifficulty)job->limits->rollout_level);
+        int claimed = MoveStack_Make(played, g, edge, player);
+        if (Player_ShouldSwitch(claimed)) player = 1 - player;
+    }
+
+    // Half the reward is the result and half the share of boxes, so lines
+    // that are all lost (or all won) still rank by margin.
+    for (int i = 0; i < depth; i++) {
+        MctsNode *node = &nodes[path[i]];
+        int mine = g->claimed[node->player];
+        int theirs = g->claimed[1 - node->player];
+        int result = mine > theirs ? 2 : mine == theirs ? 1 : 0;
+        __atomic_add_fetch(&node->value, result * g->num_boxes + 2 * mine, __ATOMIC_RELAXED);
+    }
+
+    MoveStack_Rewind(played, g, 0);
+}
+
+static void Mcts_FreeWorker(MctsWorker *w) {
+    if (!w->has_board) return;
+    Grid_Free(&w->board);
+    free(w->path);
+    MoveStack_Free(&w->played);
+    w->has_board = false;
+}
+
+static void Mcts_Worker(void *arg, int worker) {
+    MctsJob *job = arg;
+    MctsWorker *w = &job->mcts->workers[worker];
+    const Grid *root = job->root;
+    if (w->has_board && (w->board.rows != root->rows || w->board.cols != root->cols)) {
+        Mcts_FreeWorker(w);
+    }
+    if (!w->has_board) {
+        Grid_Clone(&w->board, root);
+        w->path = malloc((root->num_edges + 1) * sizeof(int));
+        MoveStack_Init(&w->played, root->num_edges);
+        w->has_board = true;
+    } else {
+        Grid_CopyInto(&w->board, root);
+    }
+    Rng rng;
+    Rng_Seed(&rng, job->seed + (uint64_t)worker * 0x9E3779B97F4A7C15ull);
+
+    // A playout costs far more than reading the clock, even on small boards.
+    while (!__atomic_load_n(&job->stop, __ATOMIC_RELAXED)) {
+        Mcts_Playout(job, &w->board, &rng, w->path, &w->played);
+        int64_t total = __atomic_add_fetch(&job->playouts, 1, __ATOMIC_RELAXED);
+        if (job->max_playouts && total >= job->max_playouts) {
+            __atomic_store_n(&job->stop, 1, __ATOMIC_RELAXED);
+        }
+        if (job->deadline_ns && Timer_NowNs() >= job->deadline_ns) {
+            __atomic_store_n(&job->stop, 1, __ATOMIC_RELAXED);
+        }
+        if (job->limits->stop && __atomic_load_n(job->limits->stop, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&job->stop, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void Mcts_Init(Mcts *mcts, int threads, int capacity) {
+    ThreadPool_Init(&mcts->pool, threads);
+    mcts->workers = calloc(mcts->pool.num_threads, sizeof(MctsWorker));
+    mcts->capacity = capacity;
+    mcts->nodes = malloc((size_t)capacity * sizeof(MctsNode));
+}
+
+void Mcts_Free(Mcts *mcts) {
+    ThreadPool_Free(&mcts->pool);
+    for (int i = 0; i < mcts->pool.num_threads; i++) {
+        Mcts_FreeWorker(&mcts->workers[i]);
+    }
+    free(mcts->workers);
+    free(mcts->nodes);
+}
+
+MctsResult Mcts_Search(Mcts *mcts, const Grid *g, int player, const MctsLimits *limits, uint64_t seed) {
+    MctsResult result = { -1, 0, 0.0, 0.0, 0.0, 0 };
+    uint64_t start = Timer_NowNs();
+    int open = Grid_count_moves(g, MOVES_OPEN);
+    if (open == 0) return result;
+    if (open == 1) {
+        result.move = Grid_nth_move(g, MOVES_OPEN, 0);
+        return result;
+    }
+
+    MctsJob job;
+    job.mcts = mcts;
+    job.root = g;
+    job.root_player = player;
+    job.limits = limits;
+    job.max_playouts = limits->max_playouts;
+    if (!limits->time_ms && !job.max_playouts) job.max_playouts = MCTS_DEFAULT_PLAYOUTS;
+    job.seed = seed;
+    job.deadline_ns = limits->time_ms > 0 ? start + (uint64_t)limits->time_ms * 1000000ull : 0;
+    job.next_node = 1;
+    job.playouts = 0;
+    job.stop = 0;
+
+    Mcts_ResetNode(&mcts->nodes[0], -1, 1 - player);
+    Mcts_Expand(&job, 0, g, player);
+    ThreadPool_Run(&mcts->pool, Mcts_Worker, &job);
+
+    MctsNode *root = &mcts->nodes[0];
+    int best = root->first_child;
+    for (int i = 0; i < root->num_children; i++) {
+        int child = root->first_child + i;
+        if (mcts->nodes[child].visits > mcts->nodes[best].visits) best = child;
+    }
+    result.move = mcts->nodes[best].move;
+    result.playouts = job.playouts;
+    result.elapsed_ms = Timer_ElapsedMs(start);
+    result.playouts_per_sec = result.elapsed_ms > 0 ? job.playouts * 1000.0 / result.elapsed_ms : 0.0;
+    if (mcts->nodes[best].visits > 0) {
+        result.win_rate = (double)mcts->nodes[best].value /
+                          ((double)MCTS_REWARD_UNITS * g->num_boxes * mcts->nodes[best].visits);
+    }
+    result.tree_nodes = job.next_node < mcts->capacity ? job.next_node : mcts->capacity;
+    return result;
+}
@@ -0,0 +1,53 @@
+#include "movestack.h"
+#include <stdlib.h>
+
+void MoveStack_Init(MoveStack *s, int capacity) {
+    s->moves = malloc(capacity * sizeof(MoveRecord));
+    s->count = 0;
+    s->top = 0;
+    s->capacity = capacity;
+}
+
+void MoveStack_Free(MoveStack *s) {
+    free(s->moves);
+    s->moves = NULL;
+    s->count = 0;
+    s->top = 0;
+    s->capacity = 0;
+}
+
+void MoveStack_Clear(MoveStack *s) {
+    s->count = 0;
+    s->top = 0;
+}
+
+int MoveStack_Make(MoveStack *s, Grid *g, int edge, int player) {
+    if (Grid_has_edge(g, edge) || s->count == s->capacity) return -1;
+    MoveRecord *m = &s->moves[s->count++];
+    m->edge = edge;
+    m->player = (int8_t)player;
+    m->claimed = (int8_t)Move_Play(g, edge, player);
+    s->top = s->count;
+    return m->claimed;
+}
+
+const MoveRecord *MoveStack_Undo(MoveStack *s, Grid *g) {
+    if (s->count == 0) return NULL;
+    const MoveRecord *m = &s->moves[--s->count];
+    Move_Unplay(g, m->edge);
+    return m;
+}
+
+const MoveRecord *MoveStack_Redo(MoveStack *s, Grid *g) {
+    if (s->count == s->top) return NULL;
+    const MoveRecord *m = &s->moves[s->count++];
+    Move_Play(g, m->edge, m->player);
+    return m;
+}
+
+void MoveStack_Rewind(MoveStack *s, Grid *g, int count) {
+    while (s->count > count) {
+        Move_Unplay(g, s->moves[--s->count].edge);
+    }
+    s->top = s->count;
+}
@@ -5,12 +5,10 @@
 
 void Players_Init(Game *game) {
     game->players[0].id = 0;
-    game->players[0].color = RED;
     game->players[0].score = 0;
     game->players[0].is_ai = false;
 
     game->players[1].id = 1;
-    game->players[1].color = BLUE;
     game->players[1].score = 0;
 
     switch (game->mode) {
@@ -37,10 +35,16 @@ bool Player_ShouldSwitch(int claimed) {
 }
 
 bool Game_IsOver(const Grid *grid) {
-    for (int i = 0; i < grid->rows * grid->cols; i++) {
-        if (grid->owners[i] == -1) return false;
+    return grid->claimed_total == grid->num_boxes;
+}
+
+// The grid's claim counters are the single source of truth for scores;
+// Game.scores and Player.score are mirrors of them for the UI.
+void Players_SyncScores(Game *game) {
+    for (int i = 0; i < 2; i++) {
+        game->scores[i] = game->grid.claimed[i];
+        game->players[i].score = game->grid.claimed[i];
     }
-    return true;
 }
 
 int Game_GetWinner(const int scores[2]) {
@@ -0,0 +1,233 @@
+#define _POSIX_C_SOURCE 200809L
+#include "record.h"
+#include "box.h"
+#include "game.h"
+#include "player.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Rows or cols beyond what the game can be set to mark a corrupt game.
+#define RECORD_MAX_SIZE GAME_MAX_SIZE
+#define RECORD_VARINT_MAX 10
+
+void RecordBuffer_Init(RecordBuffer *b) {
+    b->data = NULL;
+    b->len = 0;
+    b->cap = 0;
+    b->rows = 0;
+    b->cols = 0;
+    b->num_moves = 0;
+}
+
+void RecordBuffer_Free(RecordBuffer *b) {
+    free(b->data);
+    RecordBuffer_Init(b);
+}
+
+void RecordBuffer_Begin(RecordBuffer *b, int rows, int cols) {
+    b->len = 0;
+    b->rows = rows;
+    b->cols = cols;
+    b->num_moves = 0;
+}
+
+void RecordBuffer_Move(RecordBuffer *b, int edge) {
+    if (b->len + RECORD_VARINT_MAX > b->cap) {
+        b->cap = b->cap ? 2 * b->cap : 256;
+        b->data = realloc(b->data, b->cap);
+    }
+    b->len += Record_PutVarint(b->data + b->len, (uint64_t)edge);
+    b->num_moves++;
+}
+
+// Moves *p past the game starting there. Fails, leaving *p alone, if the
+// game runs past `end`.
+static bool Record_SkipGame(const uint8_t **p, const uint8_t *end) {
+    const uint8_t *q = *p;
+    uint64_t length;
+    if (!Record_GetVarint(&q, end, &length) || length > (uint64_t)(end - q)) return false;
+    *p = q + length;
+    return true;
+}
+
+// Size of the header and every complete game in a mapped record file.
+static size_t Record_CompleteSize(const uint8_t *base, size_t size) {
+    const uint8_t *end = base + size;
+    const uint8_t *p = base + sizeof(RecordHeader);
+    while (p < end && Record_SkipGame(&p, end)) {}
+    return (size_t)(p - base);
+}
+
+bool RecordWriter_Open(RecordWriter *w, const char *path) {
+    w->file = NULL;
+    w->games = 0;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+
+    // Only an empty file gets a fresh header; anything else has to be a
+    // record file already. A game cut short by a crash is dropped, so that
+    // new games are not appended behind it where no reader would find them.
+    size_t size = st.st_size;
+    bool ok = true;
+    if (size == 0) {
+        RecordHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+        header.version = RECORD_VERSION;
+        ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header);
+    } else if (size < sizeof(RecordHeader)) {
+        ok = false;
+    } else {
+        void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = map != MAP_FAILED;
+        if (ok) {
+            const RecordHeader *header = map;
+            ok = memcmp(header->magic, RECORD_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == RECORD_VERSION;
+            size_t complete = ok ? Record_CompleteSize(map, size) : size;
+            munmap(map, size);
+            if (ok && complete < size) ok = ftruncate(fd, (off_t)complete) == 0;
+        }
+    }
+    if (ok) w->file = fdopen(fd, "ab");
+    if (!w->file) {
+        close(fd);
+        return false;
+    }
+    pthread_mutex_init(&w->lock, NULL);
+    return true;
+}
+
+bool RecordWriter_Append(RecordWriter *w, const RecordBuffer *b) {
+    uint8_t head[4 * RECORD_VARINT_MAX];
+    uint8_t fields[3 * RECORD_VARINT_MAX];
+    size_t fields_len = Record_PutVarint(fields, (uint64_t)b->rows);
+    fields_len += Record_PutVarint(fields + fields_len, (uint64_t)b->cols);
+    fields_len += Record_PutVarint(fields + fields_len, (uint64_t)b->num_moves);
+    size_t head_len = Record_PutVarint(head, fields_len + b->len);
+    memcpy(head + head_len, fields, fields_len);
+    head_len += fields_len;
+
+    pthread_mutex_lock(&w->lock);
+    bool ok = fwrite(head, 1, head_len, w->file) == head_len &&
+              fwrite(b->data, 1, b->len, w->file) == b->len;
+    if (ok) w->games++;
+    pthread_mutex_unlock(&w->lock);
+    return ok;
+}
+
+void RecordWriter_Flush(RecordWriter *w) {
+    pthread_mutex_lock(&w->lock);
+    fflush(w->file);
+    pthread_mutex_unlock(&w->lock);
+}
+
+bool RecordWriter_Close(RecordWriter *w) {
+    if (!w->file) return true;
+    bool ok = fclose(w->file) == 0;
+    pthread_mutex_destroy(&w->lock);
+    w->file = NULL;
+    return ok;
+}
+
+bool RecordReader_Open(RecordReader *r, const char *path) {
+    r->map = NULL;
+    r->map_size = 0;
+    r->offsets = NULL;
+    r->num_games = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(RecordHeader)) {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const RecordHeader *header = map;
+    if (memcmp(header->magic, RECORD_MAGIC, sizeof(header->magic)) != 0 || header->version != RECORD_VERSION) {
+        munmap(map, st.st_size);
+        return false;
+    }
+    r->map = map;
+    r->map_size = st.st_size;
+
+    // Hop over the length prefixes; a truncated last game ends the scan.
+    const uint8_t *base = map;
+    const uint8_t *end = base + r->map_size;
+    const uint8_t *p = base + sizeof(RecordHeader);
+    uint64_t capacity = 0;
+    while (p < end) {
+        const uint8_t *start = p;
+        if (!Record_SkipGame(&p, end)) break;
+        if (r->num_games == capacity) {
+            capacity = capacity ? 2 * capacity : 1024;
+            r->offsets = realloc(r->offsets, capacity * sizeof(uint64_t));
+        }
+        r->offsets[r->num_games++] = (uint64_t)(start - base);
+    }
+    return true;
+}
+
+void RecordReader_Close(RecordReader *r) {
+    if (r->map) munmap(r->map, r->map_size);
+    free(r->offsets);
+    r->map = NULL;
+    r->map_size = 0;
+    r->offsets = NULL;
+    r->num_games = 0;
+}
+
+bool RecordReader_Game(const RecordReader *r, uint64_t index, RecordGame *game) {
+    if (index >= r->num_games) return false;
+    const uint8_t *p = (const uint8_t *)r->map + r->offsets[index];
+    const uint8_t *end = (const uint8_t *)r->map + r->map_size;
+    uint64_t length, rows, cols, moves;
+    if (!Record_GetVarint(&p, end, &length)) return false;
+    end = p + length;  // the scan already checked it fits
+    if (!Record_GetVarint(&p, end, &rows) || !Record_GetVarint(&p, end, &cols) ||
+        !Record_GetVarint(&p, end, &moves)) {
+        return false;
+    }
+    if (rows < 1 || rows > RECORD_MAX_SIZE || cols < 1 || cols > RECORD_MAX_SIZE || moves > INT_MAX) {
+        return false;
+    }
+    game->rows = (int)rows;
+    game->cols = (int)cols;
+    game->num_moves = (int)moves;
+    game->next = p;
+    game->end = end;
+    return true;
+}
+
+int RecordGame_Next(RecordGame *game) {
+    uint64_t edge;
+    if (!Record_GetVarint(&game->next, game->end, &edge) || edge > INT_MAX) return -1;
+    return (int)edge;
+}
+
+bool Record_Replay(RecordGame *game, Grid *g) {
+    if (g->rows != game->rows || g->cols != game->cols) return false;
+    int player = 0;
+    for (int i = 0; i < game->num_moves; i++) {
+        int edge = RecordGame_Next(game);
+        if (edge < 0 || edge >= g->num_edges || !Grid_set_edge(g, edge)) return false;
+        int claimed = Box_CheckAndClaimAfterEdge(g, edge, player);
+        if (Player_ShouldSwitch(claimed)) player = 1 - player;
+    }
+    return game->next == game->end;
+}
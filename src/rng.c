@@ -0,0 +1,35 @@
+#include "rng.h"
+
+static uint64_t Rng_SplitMix(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static uint64_t Rng_Rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+void Rng_Seed(Rng *rng, uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        rng->s[i] = Rng_SplitMix(&seed);
+    }
+}
+
+uint64_t Rng_Next(Rng *rng) {
+    uint64_t *s = rng->s;
+    uint64_t result = Rng_Rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = Rng_Rotl(s[3], 45);
+    return result;
+}
+
+int Rng_Range(Rng *rng, int n) {
+    return (int)(((Rng_Next(rng) >> 32) * (uint64_t)n) >> 32);
+}
@@ -0,0 +1,259 @@
+#include "search.h"
+#include "box.h"
+#include "chain.h"
+#include "endgame.h"
+#include "movestack.h"
+#include "timer.h"
+#include <stdlib.h>
+
+#define SEARCH_INF 100000
+#define SEARCH_CHECK_INTERVAL 1024
+
+typedef struct {
+    Grid *g;
+    TTable *tt;
+    SearchScratch *scratch;
+    int64_t nodes;
+    int64_t check_mask;     // limits are checked when (nodes & check_mask) == 0
+    int64_t max_nodes;
+    uint64_t deadline_ns;
+    const int32_t *stop;
+    bool stopped;
+    Endgame *endgame;
+} SearchContext;
+
+// The move list for `ply`, allocated the first time a search reaches it.
+static int *Search_PlyMoves(SearchContext *ctx, int ply) {
+    SearchScratch *s = ctx->scratch;
+    if (ply >= s->num_plies) {
+        int grown = ply * 2 + 8;
+        s->plies = realloc(s->plies, grown * sizeof(int *));
+        for (int i = s->num_plies; i < grown; i++) {
+            s->plies[i] = NULL;
+        }
+        s->num_plies = grown;
+    }
+    if (!s->plies[ply]) s->plies[ply] = malloc(s->width * sizeof(int));
+    return s->plies[ply];
+}
+
+static void Search_CheckLimits(SearchContext *ctx) {
+    if (ctx->max_nodes && ctx->nodes >= ctx->max_nodes) ctx->stopped = true;
+    if (ctx->deadline_ns && Timer_NowNs() >= ctx->deadline_ns) ctx->stopped = true;
+    if (ctx->stop && __atomic_load_n(ctx->stop, __ATOMIC_RELAXED)) ctx->stopped = true;
+}
+
+// Boxes with three sides drawn fall to the side to move. Once no safe move
+// is left the side to move must open a chain or loop, and the opponent can
+// keep control to the end: score that with the controlled value.
+static int Search_Evaluate(const Grid *g) {
+    int score = g->num_capture ? g->kernels->capturable(g) : 0;
+    const ChainSet *cs = g->chains;
+    if (score > 0 || g->num_safe > 0 || !cs || cs->num_long_chains + cs->num_loops == 0) return score;
+
+    int left = Grid_boxes_left(g);
+    int control = left - 4 * cs->num_long_chains - 8 * cs->num_loops + 4;
+    return control > 0 ? -control : 0;
+}
+
+static int Search_AppendClass(const Grid *g, MoveClass cls, int *moves, int count, int skip) {
+    return count + g->kernels->collect(g, cls, moves + count, skip);
+}
+
+// Fills `moves` with the undrawn edges: `first` (if valid) leading, then
+// captures, safe moves and sacrifices.
+static int Search_GenerateMoves(const Grid *g, int *moves, int first) {
+    int count = 0;
+    if (first >= 0 && !Grid_has_edge(g, first)) moves[count++] = first;
+    else first = -1;
+    count = Search_AppendClass(g, MOVES_CAPTURE, moves, count, first);
+    count = Search_AppendClass(g, MOVES_SAFE, moves, count, first);
+    count = Search_AppendClass(g, MOVES_SACRIFICE, moves, count, first);
+    return count;
+}
+
+// The entry's move as seen on `g`, or -1 if it is not legal here. Such an
+// entry is a key collision or was stored for another board, so its bounds
+// do not apply either.
+static int Search_TTMove(const Grid *g, int sym, const TTEntry *entry) {
+    if (entry->move < 0 || entry->move >= g->num_edges) return -1;
+    int move = Grid_sym_edge(g, Grid_sym_inverse(sym), entry->move);
+    return Grid_has_edge(g, move) ? -1 : move;
+}
+
+static int Search_Negamax(SearchContext *ctx, int depth, int ply, int alpha, int beta, int player) {
+    Grid *g = ctx->g;
+    if ((++ctx->nodes & ctx->check_mask) == 0) Search_CheckLimits(ctx);
+    if (ctx->stopped) return 0;
+
+    // Once only chains and loops are left the value has a closed form, at
+    // any depth.
+    int exact;
+    if (ctx->endgame && g->num_safe == 0 && g->num_capture == 0 && Endgame_Value(ctx->endgame, g, &exact)) {
+        return exact;
+    }
+
+    // Values only depend on the undrawn edges, so symmetric positions and
+    // transpositions share an entry whatever the move order or side to move.
+    int alpha_orig = alpha;
+    int sym = 0;
+    uint64_t key = 0;
+    int tt_move = -1;
+    if (ctx->tt && depth > 0) {
+        key = Grid_canonical_hash(g, &sym);
+        const TTEntry *entry = TT_Probe(ctx->tt, key);
+        if (entry) tt_move = Search_TTMove(g, sym, entry);
+        if (tt_move >= 0 && entry->depth >= depth) {
+            if (entry->bound == TT_EXACT) return entry->value;
+            if (entry->bound == TT_LOWER && entry->value > alpha) alpha = entry->value;
+            if (entry->bound == TT_UPPER && entry->value < beta) beta = entry->value;
+            if (alpha >= beta) return entry->value;
+        }
+    }
+
+    // Every edge is drawn exactly when every box is claimed. Leaves skip move
+    // generation, which costs a pass over the whole board.
+    if (g->claimed_total == g->num_boxes) return 0;
+    if (depth == 0) return Search_Evaluate(g);
+    int *moves = Search_PlyMoves(ctx, ply);
+    int count = Search_GenerateMoves(g, moves, tt_move);
+
+    int best = -SEARCH_INF;
+    int best_edge = moves[0];
+    for (int i = 0; i < count; i++) {
+        int edge = moves[i];
+        int value;
+        int claimed = Move_Play(g, edge, player);
+        if (claimed > 0) {
+            // Completing a box earns another move, so the side to move stays.
+            value = claimed + Search_Negamax(ctx, depth - 1, ply + 1, alpha - claimed, beta - claimed, player);
+        } else {
+            value = -Search_Negamax(ctx, depth - 1, ply + 1, -beta, -alpha, 1 - player);
+        }
+        Move_Unplay(g, edge);
+        if (ctx->stopped) return 0;
+
+        if (value > best) {
+            best = value;
+            best_edge = edge;
+        }
+        if (value > alpha) alpha = value;
+        if (alpha >= beta) break;
+    }
+
+    if (ctx->tt) {
+        TTBound bound = best <= alpha_orig ? TT_UPPER : best >= beta ? TT_LOWER : TT_EXACT;
+        TT_Store(ctx->tt, key, depth, best, bound, Grid_sym_edge(g, sym, best_edge));
+    }
+    return best;
+}
+
+static int Search_Root(SearchContext *ctx, int depth, int player, int *best_move) {
+    Grid *g = ctx->g;
+    int *moves = Search_PlyMoves(ctx, 0);
+    int count = Search_GenerateMoves(g, moves, *best_move);
+    int alpha = -SEARCH_INF;
+    int beta = SEARCH_INF;
+    int best = -SEARCH_INF;
+    int best_edge = moves[0];
+
+    for (int i = 0; i < count; i++) {
+        int edge = moves[i];
+        int value;
+        int claimed = Move_Play(g, edge, player);
+        if (claimed > 0) {
+            value = claimed + Search_Negamax(ctx, depth - 1, 1, alpha - claimed, beta - claimed, player);
+        } else {
+            value = -Search_Negamax(ctx, depth - 1, 1, -beta, -alpha, 1 - player);
+        }
+        Move_Unplay(g, edge);
+        if (ctx->stopped) break;
+
+        if (value > best) {
+            best = value;
+            best_edge = edge;
+        }
+        if (value > alpha) alpha = value;
+    }
+    if (!ctx->stopped) *best_move = best_edge;
+    return best;
+}
+
+void Search_FreeScratch(SearchScratch *scratch) {
+    for (int i = 0; i < scratch->num_plies; i++) {
+        free(scratch->plies[i]);
+    }
+    free(scratch->plies);
+    scratch->plies = NULL;
+    scratch->num_plies = 0;
+    scratch->width = 0;
+}
+
+SearchResult Search_BestMove(Grid *g, int player, const SearchLimits *limits, TTable *tt,
+                             SearchScratch *scratch) {
+    SearchResult result = { -1, 0, 0, 0, 0.0 };
+    uint64_t start = Timer_NowNs();
+    int remaining = g->num_edges - Bitset_Count(g->edges, g->edge_words);
+    if (remaining == 0) return result;
+
+    int max_depth = remaining;
+    if (limits->max_depth > 0 && limits->max_depth < max_depth) max_depth = limits->max_depth;
+
+    // The evaluation reads chain and loop counts, so keep a decomposition
+    // attached for the duration of the search.
+    ChainSet chains;
+    bool own_chains = g->chains == NULL;
+    if (own_chains) Chains_Attach(&chains, g);
+
+    // Lists are as wide as the whole board, so one scratch serves every
+    // position of a game.
+    SearchScratch local = { NULL, 0, 0 };
+    if (!scratch) scratch = &local;
+    if (scratch->width < g->num_edges) {
+        Search_FreeScratch(scratch);
+        scratch->width = g->num_edges;
+    }
+
+    SearchContext ctx;
+    ctx.g = g;
+    ctx.tt = tt;
+    ctx.scratch = scratch;
+    ctx.nodes = 0;
+    // A node costs time in proportion to the board's word count, so large
+    // boards look at the clock more often.
+    ctx.check_mask = SEARCH_CHECK_INTERVAL - 1;
+    for (int w = g->edge_words; w > 1 && ctx.check_mask > 15; w >>= 1) {
+        ctx.check_mask >>= 1;
+    }
+    ctx.max_nodes = limits->max_nodes;
+    ctx.deadline_ns = limits->time_ms > 0 ? start + (uint64_t)limits->time_ms * 1000000ull : 0;
+    ctx.stop = limits->stop;
+    ctx.stopped = false;
+    ctx.endgame = limits->endgame;
+
+    int best_move = -1;
+    for (int depth = 1; depth <= max_depth; depth++) {
+        int score = Search_Root(&ctx, depth, player, &best_move);
+        if (ctx.stopped) break;
+        result.move = best_move;
+        result.score = score;
+        result.depth = depth;
+        if (limits->info) {
+            result.nodes = ctx.nodes;
+            result.elapsed_ms = Timer_ElapsedMs(start);
+            limits->info(limits->info_arg, &result);
+        }
+    }
+    // Even a single interrupted iteration has ordered a legal move first.
+    if (result.move < 0) {
+        int *moves = Search_PlyMoves(&ctx, 0);
+        Search_GenerateMoves(g, moves, -1);
+        result.move = best_move >= 0 ? best_move : moves[0];
+    }
+
+    Search_FreeScratch(&local);
+    if (own_chains) Chains_Detach(&chains, g);
+    result.nodes = ctx.nodes;
+    result.elapsed_ms = Timer_ElapsedMs(start);
+    return result;
+}
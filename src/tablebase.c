@@ -0,0 +1,102 @@
+#define _POSIX_C_SOURCE 200809L
+#include "tablebase.h"
+#include "box.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool Tablebase_Open(Tablebase *tb, const char *path) {
+    tb->map = NULL;
+    tb->map_size = 0;
+    tb->dir = NULL;
+    tb->num_tables = 0;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TablebaseHeader)) {
+        close(fd);
+        return false;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    // Check the header and that every table lies inside the file, so probes
+    // never need to.
+    size_t size = st.st_size;
+    const TablebaseHeader *header = map;
+    const TablebaseDir *dir = (const TablebaseDir *)(header + 1);
+    bool ok = memcmp(header->magic, TABLEBASE_MAGIC, sizeof(header->magic)) == 0 &&
+              header->version == TABLEBASE_VERSION &&
+              sizeof(*header) + header->num_tables * sizeof(*dir) <= size;
+    for (uint32_t i = 0; ok && i < header->num_tables; i++) {
+        int edges = (dir[i].rows + 1) * dir[i].cols + dir[i].rows * (dir[i].cols + 1);
+        ok = dir[i].rows > 0 && dir[i].cols > 0 && edges <= TABLEBASE_MAX_EDGES &&
+             dir[i].size == (uint64_t)1 << edges && dir[i].offset <= size && dir[i].size <= size - dir[i].offset;
+    }
+    if (!ok) {
+        munmap(map, size);
+        return false;
+    }
+
+    tb->map = map;
+    tb->map_size = size;
+    tb->dir = dir;
+    tb->num_tables = header->num_tables;
+    return true;
+}
+
+void Tablebase_Close(Tablebase *tb) {
+    if (tb->map) munmap(tb->map, tb->map_size);
+    tb->map = NULL;
+    tb->map_size = 0;
+    tb->dir = NULL;
+    tb->num_tables = 0;
+}
+
+const int8_t *Tablebase_Find(const Tablebase *tb, int rows, int cols) {
+    if (!tb) return NULL;
+    for (int i = 0; i < tb->num_tables; i++) {
+        if (tb->dir[i].rows == rows && tb->dir[i].cols == cols) {
+            return (const int8_t *)tb->map + tb->dir[i].offset;
+        }
+    }
+    return NULL;
+}
+
+// Every tabulated board fits in one word.
+static uint64_t Tablebase_Index(const Grid *g) {
+    return g->edges[0];
+}
+
+bool Tablebase_Value(const Tablebase *tb, const Grid *g, int *value) {
+    const int8_t *table = Tablebase_Find(tb, g->rows, g->cols);
+    if (!table) return false;
+    *value = table[Tablebase_Index(g)];
+    return true;
+}
+
+int Tablebase_BestMove(const Tablebase *tb, const Grid *g) {
+    const int8_t *table = Tablebase_Find(tb, g->rows, g->cols);
+    if (!table) return -1;
+
+    uint64_t index = Tablebase_Index(g);
+    uint64_t open = Grid_moves_word(g, MOVES_OPEN, 0);
+    int best = -1;
+    int best_value = 0;
+    while (open) {
+        int edge = Bitset_Ctz(open);
+        open &= open - 1;
+        int captures = Box_CapturesFor(g, edge);
+        int child = table[index | (uint64_t)1 << edge];
+        int value = captures ? captures + child : -child;
+        if (best < 0 || value > best_value) {
+            best = edge;
+            best_value = value;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,166 @@
+#include "telemetry.h"
+#include <math.h>
+
+double Telemetry_BucketLimitMs(int i) {
+    return i < TELEMETRY_BUCKETS - 1 ? TELEMETRY_BUCKET0_MS * (double)(1 << i) : INFINITY;
+}
+
+#if TELEMETRY_ENABLED
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// AI moves are counted per recording thread, so workers playing many fast
+// moves never contend; Telemetry_Snapshot sums the shards. Each shard has a
+// single writer and a sequence count, odd while it is being written, so a
+// snapshot can copy it consistently without a lock. Shards live as long as
+// the process.
+typedef struct TelemetryShard {
+    uint32_t seq;
+    uint64_t stamp;         // move_stamp when last_move was recorded
+    TelemetryMove last_move;
+    uint64_t moves;
+    double move_ms;
+    int64_t nodes;
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+    struct TelemetryShard *next;
+    char pad[64];           // keeps the next shard's counters off this cache line
+} TelemetryShard;
+
+// The lock guards the frame counters, the sink and the shard list; moves
+// only take it to write to the sink.
+static pthread_mutex_t telemetry_lock = PTHREAD_MUTEX_INITIALIZER;
+static TelemetryStats telemetry;
+static FILE *telemetry_sink;
+static TelemetryShard *shards;
+static __thread TelemetryShard *local_shard;
+static uint64_t move_stamp;     // orders moves across shards
+static TelemetryHistogram window_update, window_draw;   // frames since the last sink record
+
+static void Telemetry_Add(TelemetryHistogram *h, double ms) {
+    int i = 0;
+    while (i < TELEMETRY_BUCKETS - 1 && ms >= Telemetry_BucketLimitMs(i)) i++;
+    h->counts[i]++;
+    h->samples++;
+    h->total_ms += ms;
+    if (ms > h->max_ms) h->max_ms = ms;
+}
+
+static void Telemetry_WriteHistogram(const char *name, const TelemetryHistogram *h) {
+    fprintf(telemetry_sink, ", \"%s_mean_ms\": %.4f, \"%s_max_ms\": %.4f, \"%s_buckets\": [", name,
+            h->samples ? h->total_ms / h->samples : 0.0, name, h->max_ms, name);
+    for (int i = 0; i < TELEMETRY_BUCKETS; i++) {
+        fprintf(telemetry_sink, "%s%llu", i ? ", " : "", (unsigned long long)h->counts[i]);
+    }
+    fprintf(telemetry_sink, "]");
+}
+
+bool Telemetry_OpenSink(const char *path) {
+    FILE *f = fopen(path, "a");
+    if (!f) return false;
+    pthread_mutex_lock(&telemetry_lock);
+    if (telemetry_sink) fclose(telemetry_sink);
+    __atomic_store_n(&telemetry_sink, f, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&telemetry_lock);
+    return true;
+}
+
+void Telemetry_Close(void) {
+    pthread_mutex_lock(&telemetry_lock);
+    if (telemetry_sink) fclose(telemetry_sink);
+    __atomic_store_n(&telemetry_sink, NULL, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&telemetry_lock);
+}
+
+static TelemetryShard *Telemetry_LocalShard(void) {
+    if (!local_shard) {
+        local_shard = calloc(1, sizeof(TelemetryShard));
+        pthread_mutex_lock(&telemetry_lock);
+        local_shard->next = shards;
+        shards = local_shard;
+        pthread_mutex_unlock(&telemetry_lock);
+    }
+    return local_shard;
+}
+
+void Telemetry_RecordMove(const TelemetryMove *m) {
+    TelemetryShard *shard = Telemetry_LocalShard();
+    __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    shard->stamp = __atomic_add_fetch(&move_stamp, 1, __ATOMIC_RELAXED);
+    shard->last_move = *m;
+    shard->moves++;
+    shard->move_ms += m->ms;
+    shard->nodes += m->nodes;
+    shard->tt_probes += m->tt_probes;
+    shard->tt_hits += m->tt_hits;
+    __atomic_store_n(&shard->seq, shard->seq + 1, __ATOMIC_RELEASE);
+
+    if (!__atomic_load_n(&telemetry_sink, __ATOMIC_RELAXED)) return;
+    pthread_mutex_lock(&telemetry_lock);
+    if (telemetry_sink) {
+        fprintf(telemetry_sink,
+                "{\"kind\": \"move\", \"difficulty\": %d, \"ms\": %.3f, \"nodes\": %lld, \"nodes_per_sec\": %.0f, "
+                "\"depth\": %d, \"tt_probes\": %llu, \"tt_hits\": %llu, \"tree_nodes\": %d, \"book\": %s, "
+                "\"tablebase\": %s, \"endgame\": %s}\n",
+                m->difficulty, m->ms, (long long)m->nodes, m->ms > 0 ? m->nodes * 1000.0 / m->ms : 0.0, m->depth,
+                (unsigned long long)m->tt_probes, (unsigned long long)m->tt_hits, m->tree_nodes,
+                m->book ? "true" : "false", m->tablebase ? "true" : "false", m->endgame ? "true" : "false");
+    }
+    pthread_mutex_unlock(&telemetry_lock);
+}
+
+void Telemetry_RecordFrame(double update_ms, double draw_ms) {
+    pthread_mutex_lock(&telemetry_lock);
+    Telemetry_Add(&telemetry.update, update_ms);
+    Telemetry_Add(&telemetry.draw, draw_ms);
+    if (telemetry_sink) {
+        Telemetry_Add(&window_update, update_ms);
+        Telemetry_Add(&window_draw, draw_ms);
+        if (window_draw.samples == TELEMETRY_FRAME_WINDOW) {
+            fprintf(telemetry_sink, "{\"kind\": \"frames\", \"frames\": %d", TELEMETRY_FRAME_WINDOW);
+            Telemetry_WriteHistogram("update", &window_update);
+            Telemetry_WriteHistogram("draw", &window_draw);
+            fprintf(telemetry_sink, "}\n");
+            memset(&window_update, 0, sizeof(window_update));
+            memset(&window_draw, 0, sizeof(window_draw));
+        }
+    }
+    pthread_mutex_unlock(&telemetry_lock);
+}
+
+// A consistent copy of a shard another thread may be writing.
+static void Telemetry_ReadShard(const TelemetryShard *shard, TelemetryShard *copy) {
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&shard->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue;
+        *copy = *shard;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shard->seq, __ATOMIC_RELAXED) == seq) return;
+    }
+}
+
+void Telemetry_Snapshot(TelemetryStats *out) {
+    pthread_mutex_lock(&telemetry_lock);
+    *out = telemetry;
+    uint64_t latest = 0;
+    for (const TelemetryShard *shard = shards; shard; shard = shard->next) {
+        TelemetryShard copy;
+        Telemetry_ReadShard(shard, &copy);
+        out->moves += copy.moves;
+        out->move_ms += copy.move_ms;
+        out->nodes += copy.nodes;
+        out->tt_probes += copy.tt_probes;
+        out->tt_hits += copy.tt_hits;
+        if (copy.moves && copy.stamp >= latest) {
+            latest = copy.stamp;
+            out->last_move = copy.last_move;
+        }
+    }
+    pthread_mutex_unlock(&telemetry_lock);
+}
+
+#endif
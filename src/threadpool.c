@@ -0,0 +1,90 @@
+#define _POSIX_C_SOURCE 200809L
+#include "threadpool.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+    ThreadPool *pool;
+    int index;
+} ThreadPoolSeat;
+
+static void *ThreadPool_Main(void *arg) {
+    ThreadPoolSeat *seat = arg;
+    ThreadPool *pool = seat->pool;
+    int index = seat->index;
+    free(seat);
+
+    unsigned seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->quit && pool->generation == seen) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->quit) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->generation;
+        ThreadPoolFn fn = pool->fn;
+        void *job = pool->arg;
+        pthread_mutex_unlock(&pool->lock);
+
+        fn(job, index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->running == 0) pthread_cond_signal(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+int ThreadPool_DefaultThreads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+void ThreadPool_Init(ThreadPool *pool, int threads) {
+    if (threads <= 0) threads = ThreadPool_DefaultThreads();
+    pool->num_threads = threads;
+    pool->threads = malloc(threads * sizeof(pthread_t));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->fn = NULL;
+    pool->arg = NULL;
+    pool->generation = 0;
+    pool->running = 0;
+    pool->quit = false;
+    for (int i = 0; i < threads; i++) {
+        ThreadPoolSeat *seat = malloc(sizeof(ThreadPoolSeat));
+        seat->pool = pool;
+        seat->index = i;
+        pthread_create(&pool->threads[i], NULL, ThreadPool_Main, seat);
+    }
+}
+
+void ThreadPool_Free(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    free(pool->threads);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+}
+
+void ThreadPool_Run(ThreadPool *pool, ThreadPoolFn fn, void *arg) {
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->running = pool->num_threads;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    while (pool->running > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
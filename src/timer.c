@@ -0,0 +1,13 @@
+#define _POSIX_C_SOURCE 199309L
+#include "timer.h"
+#include <time.h>
+
+uint64_t Timer_NowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+double Timer_ElapsedMs(uint64_t start_ns) {
+    return (double)(Timer_NowNs() - start_ns) / 1e6;
+}
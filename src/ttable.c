@@ -0,0 +1,58 @@
+#include "ttable.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool TT_Init(TTable *tt, size_t megabytes) {
+    size_t bytes = megabytes * 1024 * 1024;
+    size_t count = 1;
+    while (count * 2 * sizeof(TTBucket) <= bytes) count *= 2;
+    tt->buckets = calloc(count, sizeof(TTBucket));
+    tt->num_buckets = tt->buckets ? count : 0;
+    tt->probes = tt->hits = tt->stores = tt->collisions = 0;
+    return tt->buckets != NULL;
+}
+
+void TT_Free(TTable *tt) {
+    free(tt->buckets);
+    tt->buckets = NULL;
+    tt->num_buckets = 0;
+}
+
+void TT_Clear(TTable *tt) {
+    memset(tt->buckets, 0, tt->num_buckets * sizeof(TTBucket));
+    tt->probes = tt->hits = tt->stores = tt->collisions = 0;
+}
+
+const TTEntry *TT_Probe(TTable *tt, uint64_t key) {
+    TTBucket *bucket = &tt->buckets[key & (tt->num_buckets - 1)];
+    tt->probes++;
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        if (bucket->slots[i].bound != TT_EMPTY && bucket->slots[i].key == key) {
+            tt->hits++;
+            return &bucket->slots[i];
+        }
+    }
+    return NULL;
+}
+
+void TT_Store(TTable *tt, uint64_t key, int depth, int value, TTBound bound, int move) {
+    TTBucket *bucket = &tt->buckets[key & (tt->num_buckets - 1)];
+    TTEntry *victim = &bucket->slots[0];
+    for (int i = 0; i < TT_BUCKET_SIZE; i++) {
+        TTEntry *slot = &bucket->slots[i];
+        if (slot->bound != TT_EMPTY && slot->key == key) {
+            // Same position: keep whichever result came from the deeper search.
+            if (depth < slot->depth) return;
+            victim = slot;
+            break;
+        }
+        if (slot->bound == TT_EMPTY || slot->depth < victim->depth) victim = slot;
+    }
+    if (victim->bound != TT_EMPTY && victim->key != key) tt->collisions++;
+    tt->stores++;
+    victim->key = key;
+    victim->move = move;
+    victim->value = (int16_t)value;
+    victim->depth = (uint8_t)(depth > 255 ? 255 : depth);
+    victim->bound = (uint8_t)bound;
+}
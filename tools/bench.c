@@ -0,0 +1,404 @@
+#define _POSIX_C_SOURCE 200809L
+#include "ai.h"
+#include "box.h"
+#include "classify.h"
+#include "grid.h"
+#include "mcts.h"
+#include "movestack.h"
+#include "player.h"
+#include "search.h"
+#include "timer.h"
+#include "ttable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Microbenchmarks for the rules kernels and per-move latency of every AI
+// level, on seeded positions so runs are comparable. Results go to a JSON
+// Lines file, easy to diff or feed to jq: a "config" record with the run's
+// settings, then one "kernel" or "move" record per measurement.
+
+#define BENCH_POSITIONS 32
+#define BENCH_MAX_SIZES 16
+
+typedef struct {
+    int sizes[BENCH_MAX_SIZES];
+    int num_sizes;
+    uint64_t seed;
+    int min_ms;             // each kernel runs at least this long
+    int reps;               // latency samples per position
+    int64_t hard_nodes;     // node budget per Hard move
+    int64_t mcts_playouts;  // playout budget per MCTS move
+    const char *out_path;
+} BenchConfig;
+
+typedef struct {
+    int size;
+    Grid grids[BENCH_POSITIONS];
+    int players[BENCH_POSITIONS];
+    int *moves;             // scratch move list, one slot per edge
+    int64_t sink;           // keeps results alive past the optimiser
+} BenchCase;
+
+typedef void (*BenchKernel)(BenchCase *bc, int64_t iters);
+
+static FILE *bench_out;
+static volatile int64_t bench_sink;
+
+static const char *level_names[] = { "random", "easy", "medium", "hard", "mcts" };
+
+// Plays a random number of random moves from the empty board.
+static void Bench_MakePosition(Grid *g, int *player, Rng *rng) {
+    int plies = Rng_Range(rng, g->num_edges * 9 / 10 + 1);
+    *player = 0;
+    for (int i = 0; i < plies && !Game_IsOver(g); i++) {
+        int edge = AI_PolicyMove(rng, g, AI_DIFFICULTY_RANDOM);
+        Grid_set_edge(g, edge);
+        if (Player_ShouldSwitch(Box_CheckAndClaimAfterEdge(g, edge, *player))) *player = 1 - *player;
+    }
+}
+
+static void Bench_InitCase(BenchCase *bc, int size, uint64_t seed) {
+    Rng rng;
+    Rng_Seed(&rng, seed ^ ((uint64_t)size << 32));
+    bc->size = size;
+    for (int i = 0; i < BENCH_POSITIONS; i++) {
+        Grid_Init(&bc->grids[i], size, size);
+        Bench_MakePosition(&bc->grids[i], &bc->players[i], &rng);
+    }
+    bc->moves = malloc(bc->grids[0].num_edges * sizeof(int));
+    bc->sink = 0;
+}
+
+static void Bench_FreeCase(BenchCase *bc) {
+    for (int i = 0; i < BENCH_POSITIONS; i++) {
+        Grid_Free(&bc->grids[i]);
+    }
+    free(bc->moves);
+}
+
+// Every open edge of `g`, as the old GetValidMoves returned them.
+static int Bench_CollectMoves(const Grid *g, int *moves) {
+    return g->kernels->collect(g, MOVES_OPEN, moves, -1);
+}
+
+static void Kernel_InitFree(BenchCase *bc, int64_t iters) {
+    for (int64_t i = 0; i < iters; i++) {
+        Grid g;
+        Grid_Init(&g, bc->size, bc->size);
+        bc->sink += g.num_edges;
+        Grid_Free(&g);
+    }
+}
+
+static void Kernel_Copy(BenchCase *bc, int64_t iters) {
+    Grid g;
+    Grid_Init(&g, bc->size, bc->size);
+    for (int64_t i = 0; i < iters; i++) {
+        Grid_CopyInto(&g, &bc->grids[i % BENCH_POSITIONS]);
+    }
+    bc->sink += g.claimed_total;
+    Grid_Free(&g);
+}
+
+static void Kernel_Clone(BenchCase *bc, int64_t iters) {
+    for (int64_t i = 0; i < iters; i++) {
+        Grid g;
+        Grid_Clone(&g, &bc->grids[i % BENCH_POSITIONS]);
+        bc->sink += g.claimed_total;
+        Grid_Free(&g);
+    }
+}
+
+static void Kernel_MoveGen(BenchCase *bc, int64_t iters) {
+    for (int64_t i = 0; i < iters; i++) {
+        bc->sink += Bench_CollectMoves(&bc->grids[i % BENCH_POSITIONS], bc->moves);
+    }
+}
+
+// One op classifies every open edge of a position from the side counts of
+// the boxes beside it, the test a move generator without the maintained
+// classes would make per move.
+static void Kernel_Classify(BenchCase *bc, int64_t iters) {
+    for (int64_t i = 0; i < iters; i++) {
+        const Grid *g = &bc->grids[i % BENCH_POSITIONS];
+        int captures = 0, safe = 0;
+        for (int e = 0; e < g->num_edges; e++) {
+            if (Grid_has_edge(g, e)) continue;
+            const int *boxes = Grid_edge_boxes(g, e);
+            int most = 0;
+            for (int k = 0; k < 2; k++) {
+                if (boxes[k] >= 0 && g->sides[boxes[k]] > most) most = g->sides[boxes[k]];
+            }
+            captures += most == 3;
+            safe += most <= 1;
+        }
+        bc->sink += captures + safe;
+    }
+}
+
+// One op is a make plus the matching unmake of a single edge.
+static void Kernel_MakeUnmake(BenchCase *bc, int64_t iters) {
+    int64_t done = 0;
+    for (int p = 0; done < iters; p = (p + 1) % BENCH_POSITIONS) {
+        Grid *g = &bc->grids[p];
+        int n = Bench_CollectMoves(g, bc->moves);
+        for (int i = 0; i < n && done < iters; i++, done++) {
+            bc->sink += Move_Play(g, bc->moves[i], 0);
+            Move_Unplay(g, bc->moves[i]);
+        }
+        if (n == 0) done++;
+    }
+}
+
+// The coordinate-based claim checks on drawn edges, where they find nothing
+// new to claim, as after every move in the UI.
+static void Kernel_ClaimHV(BenchCase *bc, int64_t iters) {
+    int64_t done = 0;
+    for (int p = 0; done < iters; p = (p + 1) % BENCH_POSITIONS) {
+        Grid *g = &bc->grids[p];
+        for (int e = 0; e < g->num_edges && done < iters; e++, done++) {
+            bool horizontal;
+            int r, c;
+            Grid_edge_coords(g, e, &horizontal, &r, &c);
+            bc->sink += horizontal ? Box_CheckAndClaimAfterHorizontal(g, r, c, 0)
+                                   : Box_CheckAndClaimAfterVertical(g, r, c, 0);
+        }
+    }
+}
+
+// Rebuilding a position from its edge set: one bulk classification pass,
+// against drawing the same edges one at a time onto an empty board.
+static void Kernel_LoadPosition(BenchCase *bc, int64_t iters) {
+    Grid g;
+    Grid_Init(&g, bc->size, bc->size);
+    for (int64_t i = 0; i < iters; i++) {
+        const Grid *src = &bc->grids[i % BENCH_POSITIONS];
+        Grid_SetPosition(&g, src->edges, src->owned[1]);
+        bc->sink += g.num_capture;
+    }
+    Grid_Free(&g);
+}
+
+static void Kernel_LoadIncremental(BenchCase *bc, int64_t iters) {
+    Grid empty, g;
+    Grid_Init(&empty, bc->size, bc->size);
+    Grid_Init(&g, bc->size, bc->size);
+    for (int64_t i = 0; i < iters; i++) {
+        const Grid *src = &bc->grids[i % BENCH_POSITIONS];
+        Grid_CopyInto(&g, &empty);
+        for (int w = 0; w < src->edge_words; w++) {
+            for (uint64_t word = src->edges[w]; word; word &= word - 1) {
+                Grid_set_edge(&g, w * 64 + Bitset_Ctz(word));
+            }
+        }
+        bc->sink += g.num_capture;
+    }
+    Grid_Free(&empty);
+    Grid_Free(&g);
+}
+
+static void Kernel_CanonicalHash(BenchCase *bc, int64_t iters) {
+    for (int64_t i = 0; i < iters; i++) {
+        bc->sink += Grid_canonical_hash(&bc->grids[i % BENCH_POSITIONS], NULL);
+    }
+}
+
+// Doubles the iteration count until a run lasts min_ms, then reports that run.
+static void Bench_Kernel(const BenchConfig *config, BenchCase *bc, const char *name, BenchKernel kernel) {
+    uint64_t min_ns = (uint64_t)config->min_ms * 1000000ull;
+    int64_t iters = 1;
+    uint64_t elapsed;
+    for (;;) {
+        uint64_t start = Timer_NowNs();
+        kernel(bc, iters);
+        elapsed = Timer_NowNs() - start;
+        if (elapsed >= min_ns || iters >= ((int64_t)1 << 40)) break;
+        iters *= elapsed < min_ns / 16 ? 8 : 2;
+    }
+    double ns_per_op = (double)elapsed / iters;
+    fprintf(stderr, "%-16s %3dx%-3d %12.1f ns/op\n", name, bc->size, bc->size, ns_per_op);
+    if (bench_out) {
+        fprintf(bench_out, "{\"kind\": \"kernel\", \"name\": \"%s\", \"rows\": %d, \"cols\": %d, "
+                "\"iters\": %lld, \"ns_per_op\": %.2f}\n", name, bc->size, bc->size, (long long)iters, ns_per_op);
+    }
+}
+
+static int Bench_CompareDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double Bench_Percentile(const double *sorted, int n, double p) {
+    int i = (int)(p * (n - 1) + 0.5);
+    return sorted[i];
+}
+
+// Move latency of one AI level over every position. Hard and MCTS run on
+// fixed node and playout budgets, so the work per move does not depend on
+// machine speed and nodes/s is comparable between runs.
+static void Bench_Latency(const BenchConfig *config, BenchCase *bc, AIDifficulty level) {
+    int samples = BENCH_POSITIONS * config->reps;
+    double *us = malloc(samples * sizeof(double));
+    int64_t work = 0;
+    double total_ms = 0.0;
+    int n = 0;
+
+    Rng rng;
+    Rng_Seed(&rng, config->seed);
+    TTable tt;
+    SearchScratch scratch = { NULL, 0, 0 };
+    Mcts mcts;
+    SearchLimits search_limits = { 0, 0, config->hard_nodes, NULL, NULL, NULL, NULL };
+    MctsLimits mcts_limits = { 0, config->mcts_playouts, AI_DIFFICULTY_MEDIUM, 1.0, NULL };
+    if (level == AI_DIFFICULTY_HARD) TT_Init(&tt, AI_HASH_MB);
+    if (level == AI_DIFFICULTY_MCTS) Mcts_Init(&mcts, 1, MCTS_DEFAULT_NODES);
+
+    for (int rep = 0; rep < config->reps; rep++) {
+        for (int p = 0; p < BENCH_POSITIONS; p++) {
+            Grid *g = &bc->grids[p];
+            if (Game_IsOver(g)) continue;
+            uint64_t start = Timer_NowNs();
+            if (level == AI_DIFFICULTY_HARD) {
+                TT_Clear(&tt);
+                SearchResult result = Search_BestMove(g, bc->players[p], &search_limits, &tt, &scratch);
+                work += result.nodes;
+                bc->sink += result.move;
+            } else if (level == AI_DIFFICULTY_MCTS) {
+                MctsResult result = Mcts_Search(&mcts, g, bc->players[p], &mcts_limits, config->seed + p);
+                work += result.playouts;
+                bc->sink += result.move;
+            } else {
+                bc->sink += AI_PolicyMove(&rng, g, level);
+            }
+            uint64_t elapsed = Timer_NowNs() - start;
+            us[n++] = elapsed / 1000.0;
+            total_ms += elapsed / 1e6;
+        }
+    }
+
+    if (level == AI_DIFFICULTY_HARD) TT_Free(&tt);
+    Search_FreeScratch(&scratch);
+    if (level == AI_DIFFICULTY_MCTS) Mcts_Free(&mcts);
+    if (n == 0) {
+        free(us);
+        return;
+    }
+
+    qsort(us, n, sizeof(double), Bench_CompareDouble);
+    double p50 = Bench_Percentile(us, n, 0.50);
+    double p99 = Bench_Percentile(us, n, 0.99);
+    double work_per_sec = total_ms > 0 ? work * 1000.0 / total_ms : 0.0;
+    const char *name = level_names[level];
+    fprintf(stderr, "move/%-11s %3dx%-3d p50 %10.1f us  p99 %10.1f us", name, bc->size, bc->size, p50, p99);
+    if (work) fprintf(stderr, "  %.0f %s/s", work_per_sec, level == AI_DIFFICULTY_MCTS ? "playouts" : "nodes");
+    fprintf(stderr, "\n");
+
+    if (bench_out) {
+        fprintf(bench_out, "{\"kind\": \"move\", \"name\": \"%s\", \"rows\": %d, \"cols\": %d, "
+                "\"samples\": %d, \"p50_us\": %.2f, \"p99_us\": %.2f, \"mean_us\": %.2f",
+                name, bc->size, bc->size, n, p50, p99, total_ms * 1000.0 / n);
+        if (level == AI_DIFFICULTY_HARD) fprintf(bench_out, ", \"nodes_per_sec\": %.0f", work_per_sec);
+        if (level == AI_DIFFICULTY_MCTS) fprintf(bench_out, ", \"playouts_per_sec\": %.0f", work_per_sec);
+        fprintf(bench_out, "}\n");
+    }
+    free(us);
+}
+
+static bool Bench_ParseSizes(BenchConfig *config, char *list) {
+    config->num_sizes = 0;
+    for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+        int size = atoi(tok);
+        if (size < 1 || config->num_sizes == BENCH_MAX_SIZES) return false;
+        config->sizes[config->num_sizes++] = size;
+    }
+    return config->num_sizes > 0;
+}
+
+static void Bench_Usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-o out.jsonl] [-z sizes] [-s seed] [-m min_ms] [-r reps]\n"
+            "          [-N hard_nodes] [-P mcts_playouts]\n"
+            "sizes are comma separated square board sizes, default 3,4,5,6,8,10,12,16,20\n", prog);
+}
+
+int main(int argc, char **argv) {
+    static const int default_sizes[] = { 3, 4, 5, 6, 8, 10, 12, 16, 20 };
+    BenchConfig config;
+    config.num_sizes = (int)(sizeof(default_sizes) / sizeof(default_sizes[0]));
+    memcpy(config.sizes, default_sizes, sizeof(default_sizes));
+    config.seed = 1;
+    config.min_ms = 100;
+    config.reps = 4;
+    config.hard_nodes = 20000;
+    config.mcts_playouts = 500;
+    config.out_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:z:s:m:r:N:P:h")) != -1) {
+        switch (opt) {
+            case 'o': config.out_path = optarg; break;
+            case 's': config.seed = strtoull(optarg, NULL, 10); break;
+            case 'm': config.min_ms = atoi(optarg); break;
+            case 'r': config.reps = atoi(optarg); break;
+            case 'N': config.hard_nodes = atoll(optarg); break;
+            case 'P': config.mcts_playouts = atoll(optarg); break;
+            case 'z':
+                if (!Bench_ParseSizes(&config, optarg)) {
+                    Bench_Usage(argv[0]);
+                    return 1;
+                }
+                break;
+            default:
+                Bench_Usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (config.min_ms < 1) config.min_ms = 1;
+    if (config.reps < 1) config.reps = 1;
+
+    if (config.out_path) {
+        bench_out = fopen(config.out_path, "w");
+        if (!bench_out) {
+            perror(config.out_path);
+            return 1;
+        }
+        fprintf(bench_out, "{\"kind\": \"config\", \"seed\": %llu, \"min_ms\": %d, \"hard_nodes\": %lld, "
+                "\"mcts_playouts\": %lld}\n", (unsigned long long)config.seed, config.min_ms,
+                (long long)config.hard_nodes, (long long)config.mcts_playouts);
+    }
+
+    for (int i = 0; i < config.num_sizes; i++) {
+        BenchCase bc;
+        Bench_InitCase(&bc, config.sizes[i], config.seed);
+        Bench_Kernel(&config, &bc, "grid_init_free", Kernel_InitFree);
+        Bench_Kernel(&config, &bc, "grid_copy", Kernel_Copy);
+        Bench_Kernel(&config, &bc, "grid_clone", Kernel_Clone);
+        Bench_Kernel(&config, &bc, "movegen", Kernel_MoveGen);
+        Bench_Kernel(&config, &bc, "classify", Kernel_Classify);
+        Bench_Kernel(&config, &bc, "make_unmake", Kernel_MakeUnmake);
+        Bench_Kernel(&config, &bc, "claim_hv", Kernel_ClaimHV);
+        Bench_Kernel(&config, &bc, "canonical_hash", Kernel_CanonicalHash);
+        Bench_Kernel(&config, &bc, "load_incremental", Kernel_LoadIncremental);
+        const char *impl = Classify_Impl();
+        static const char *impls[] = { "scalar", "sse2", "avx2" };
+        for (int k = 0; k < 3; k++) {
+            if (!Classify_Use(impls[k])) continue;
+            char name[32];
+            snprintf(name, sizeof(name), "load_%s", impls[k]);
+            Bench_Kernel(&config, &bc, name, Kernel_LoadPosition);
+        }
+        Classify_Use(impl);
+        for (int level = AI_DIFFICULTY_RANDOM; level <= AI_DIFFICULTY_MCTS; level++) {
+            Bench_Latency(&config, &bc, (AIDifficulty)level);
+        }
+        bench_sink += bc.sink;
+        Bench_FreeCase(&bc);
+    }
+
+    if (bench_out) {
+        fclose(bench_out);
+    }
+    return 0;
+}
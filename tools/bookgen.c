@@ -0,0 +1,352 @@
+#define _POSIX_C_SOURCE 200809L
+#include "book.h"
+#include "endgame.h"
+#include "game.h"
+#include "grid.h"
+#include "movestack.h"
+#include "rng.h"
+#include "search.h"
+#include "threadpool.h"
+#include "timer.h"
+#include "ttable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Builds the opening book. Every position reachable in fewer than `plies`
+// moves is enumerated once up to symmetry, a ply at a time. Each position
+// then has every distinct move searched on the thread pool, and up to
+// BOOK_MOVES moves within `margin` boxes of the best are kept, weighted
+// towards the best. Moves that tie are kept in a random order seeded by the
+// position's key, so the edge numbering does not pick among them. A position
+// where every move is within the margin is left out: the book has nothing to
+// say there, and the search plays it instead.
+
+typedef struct {
+    int rows;
+    int cols;
+    int plies;
+    int margin;
+    SearchLimits limits;    // per move searched
+    size_t hash_mb;
+} BookgenConfig;
+
+typedef struct {
+    int edge;
+    int value;
+    uint64_t order;         // random, breaks ties in value
+} BookgenMove;
+
+// One worker's search state, kept from position to position.
+typedef struct {
+    Grid grid;
+    TTable tt;
+    SearchScratch scratch;
+    Endgame endgame;
+    BookgenMove *moves;     // the distinct moves of the current position
+    uint64_t *child_keys;   // and the canonical keys they lead to
+    int64_t nodes;
+} BookgenWorker;
+
+typedef struct {
+    const BookgenConfig *config;
+    BookgenWorker *workers;
+    const uint64_t *positions;  // edge_words words per position
+    int edge_words;
+    int count;
+    int next;                   // next position to claim
+    BookEntry *entries;
+    bool *kept;                 // per position: false if left out of the book
+} BookgenJob;
+
+// Open-addressed set of canonical keys, so each position is kept once.
+typedef struct {
+    uint64_t *keys;
+    size_t capacity;
+    size_t count;
+} BookgenSet;
+
+static bool BookgenSet_Add(BookgenSet *set, uint64_t key);
+
+static void BookgenSet_Grow(BookgenSet *set) {
+    uint64_t *keys = set->keys;
+    size_t old = set->capacity;
+    set->capacity = old ? 2 * old : 1024;
+    set->keys = calloc(set->capacity, sizeof(uint64_t));
+    set->count = 0;
+    for (size_t i = 0; i < old; i++) {
+        if (keys[i]) BookgenSet_Add(set, keys[i]);
+    }
+    free(keys);
+}
+
+// False if `key` was already in the set.
+static bool BookgenSet_Add(BookgenSet *set, uint64_t key) {
+    // 0 marks an empty slot.
+    if (key == 0) key = 1;
+    if ((set->count + 1) * 2 > set->capacity) BookgenSet_Grow(set);
+    size_t i = key & (set->capacity - 1);
+    while (set->keys[i]) {
+        if (set->keys[i] == key) return false;
+        i = (i + 1) & (set->capacity - 1);
+    }
+    set->keys[i] = key;
+    set->count++;
+    return true;
+}
+
+// Every position of fewer than `plies` moves, up to symmetry, as edge sets.
+static uint64_t *Bookgen_Enumerate(const BookgenConfig *config, int *count) {
+    Grid g;
+    Grid_Init(&g, config->rows, config->cols);
+    int words = g.edge_words;
+    size_t capacity = 1024;
+    uint64_t *positions = malloc(capacity * words * sizeof(uint64_t));
+    BookgenSet seen = { NULL, 0, 0 };
+
+    memcpy(positions, g.edges, words * sizeof(uint64_t));
+    BookgenSet_Add(&seen, Grid_canonical_hash(&g, NULL));
+    int n = 1;
+    int level_begin = 0;
+    for (int ply = 1; ply < config->plies; ply++) {
+        int level_end = n;
+        for (int i = level_begin; i < level_end; i++) {
+            Grid_SetPosition(&g, positions + (size_t)i * words, NULL);
+            for (int e = 0; e < g.num_edges; e++) {
+                if (Grid_has_edge(&g, e)) continue;
+                Move_Play(&g, e, 0);
+                if (g.num_open > 0 && BookgenSet_Add(&seen, Grid_canonical_hash(&g, NULL))) {
+                    if ((size_t)n == capacity) {
+                        capacity *= 2;
+                        positions = realloc(positions, capacity * words * sizeof(uint64_t));
+                    }
+                    memcpy(positions + (size_t)n * words, g.edges, words * sizeof(uint64_t));
+                    n++;
+                }
+                Move_Unplay(&g, e);
+            }
+        }
+        fprintf(stderr, "ply %d: %d positions\n", ply, n - level_end);
+        level_begin = level_end;
+    }
+
+    free(seen.keys);
+    Grid_Free(&g);
+    *count = n;
+    return positions;
+}
+
+static int Bookgen_CompareMoves(const void *a, const void *b) {
+    const BookgenMove *x = a, *y = b;
+    if (x->value != y->value) return y->value - x->value;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+static int Bookgen_CompareEntries(const void *a, const void *b) {
+    const BookEntry *x = a, *y = b;
+    return x->key < y->key ? -1 : x->key > y->key;
+}
+
+// Searches every distinct move of position `index` and fills in its entry,
+// or returns false if no move is better than another by more than the margin.
+static bool Bookgen_Solve(BookgenJob *job, BookgenWorker *w, int index, BookEntry *out) {
+    const BookgenConfig *config = job->config;
+    Grid *g = &w->grid;
+    Grid_SetPosition(g, job->positions + (size_t)index * job->edge_words, NULL);
+    int sym;
+    out->key = Grid_canonical_hash(g, &sym);
+    Rng rng;
+    Rng_Seed(&rng, out->key);
+
+    SearchLimits limits = config->limits;
+    limits.endgame = &w->endgame;
+    BookgenMove *moves = w->moves;
+    int num_moves = 0;
+    for (int e = 0; e < g->num_edges; e++) {
+        if (Grid_has_edge(g, e)) continue;
+        int claimed = Move_Play(g, e, 0);
+        // Moves that are images of one another under a symmetry of this
+        // position are worth the same; one of them is enough.
+        uint64_t key = Grid_canonical_hash(g, NULL);
+        bool repeat = false;
+        for (int i = 0; i < num_moves && !repeat; i++) repeat = w->child_keys[i] == key;
+        if (!repeat) {
+            SearchResult result = Search_BestMove(g, claimed ? 0 : 1, &limits, &w->tt, &w->scratch);
+            w->nodes += result.nodes;
+            w->child_keys[num_moves] = key;
+            moves[num_moves].edge = e;
+            moves[num_moves].value = claimed ? claimed + result.score : -result.score;
+            moves[num_moves].order = Rng_Next(&rng);
+            num_moves++;
+        }
+        Move_Unplay(g, e);
+    }
+    qsort(moves, num_moves, sizeof(BookgenMove), Bookgen_CompareMoves);
+    if (moves[0].value - moves[num_moves - 1].value <= config->margin) return false;
+
+    memset(out->moves, 0, sizeof(out->moves));
+    memset(out->weights, 0, sizeof(out->weights));
+    for (int i = 0; i < num_moves && i < BOOK_MOVES; i++) {
+        int gap = moves[0].value - moves[i].value;
+        if (gap > config->margin) break;
+        out->moves[i] = (uint16_t)Grid_sym_edge(g, sym, moves[i].edge);
+        out->weights[i] = (uint16_t)(config->margin + 1 - gap);
+    }
+    return true;
+}
+
+static void Bookgen_Worker(void *arg, int worker) {
+    BookgenJob *job = arg;
+    BookgenWorker *w = &job->workers[worker];
+    for (;;) {
+        int index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (index >= job->count) break;
+        job->kept[index] = Bookgen_Solve(job, w, index, &job->entries[index]);
+    }
+}
+
+static bool Bookgen_Write(const char *path, const BookgenConfig *config, BookEntry *entries, int count) {
+    qsort(entries, count, sizeof(BookEntry), Bookgen_CompareEntries);
+
+    // About one entry per index slot.
+    BookHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BOOK_MAGIC, sizeof(header.magic));
+    header.version = BOOK_VERSION;
+    header.rows = config->rows;
+    header.cols = config->cols;
+    header.plies = config->plies;
+    header.index_bits = 1;
+    while (header.index_bits < BOOK_MAX_INDEX_BITS && ((uint64_t)1 << header.index_bits) < (uint64_t)count) {
+        header.index_bits++;
+    }
+    header.num_entries = count;
+
+    uint32_t buckets = (uint32_t)1 << header.index_bits;
+    uint32_t *index = malloc((buckets + 1) * sizeof(uint32_t));
+    uint32_t i = 0;
+    for (uint32_t b = 0; b <= buckets; b++) {
+        while (i < (uint32_t)count && Book_Bucket(entries[i].key, header.index_bits) < b) i++;
+        index[b] = i;
+    }
+
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        perror(path);
+        free(index);
+        return false;
+    }
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(index, sizeof(uint32_t), buckets + 1, out);
+    static const uint8_t zeros[8];
+    uint64_t written = sizeof(header) + (buckets + 1) * sizeof(uint32_t);
+    fwrite(zeros, 1, Book_EntriesOffset(&header) - written, out);
+    fwrite(entries, sizeof(BookEntry), count, out);
+    free(index);
+    if (fclose(out) != 0) {
+        perror(path);
+        return false;
+    }
+    return true;
+}
+
+static void Bookgen_Usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-o file] [-r rows] [-c cols] [-p plies] [-m margin]\n"
+            "          [-N nodes] [-D depth] [-T ms] [-t threads] [-H hash_mb]\n"
+            "books every position of fewer than `plies` moves (default 3) on a\n"
+            "rows x cols board (default 5x5); limits apply to each move searched\n"
+            "(default 1000000 nodes)\n", prog);
+}
+
+int main(int argc, char **argv) {
+    const char *path = BOOK_PATH;
+    BookgenConfig config;
+    config.rows = 5;
+    config.cols = 5;
+    config.plies = 3;
+    config.margin = 0;
+    config.limits.max_depth = 0;
+    config.limits.time_ms = 0;
+    config.limits.max_nodes = 1000000;
+    config.limits.stop = NULL;
+    config.limits.info = NULL;
+    config.limits.info_arg = NULL;
+    config.limits.endgame = NULL;
+    config.hash_mb = 16;
+    int threads = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:r:c:p:m:N:D:T:t:H:h")) != -1) {
+        switch (opt) {
+            case 'o': path = optarg; break;
+            case 'r': config.rows = atoi(optarg); break;
+            case 'c': config.cols = atoi(optarg); break;
+            case 'p': config.plies = atoi(optarg); break;
+            case 'm': config.margin = atoi(optarg); break;
+            case 'N': config.limits.max_nodes = atoll(optarg); break;
+            case 'D': config.limits.max_depth = atoi(optarg); break;
+            case 'T': config.limits.time_ms = atoi(optarg); break;
+            case 't': threads = atoi(optarg); break;
+            case 'H': config.hash_mb = (size_t)atoi(optarg); break;
+            default:
+                Bookgen_Usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (config.rows < 1 || config.cols < 1 || config.rows > GAME_MAX_SIZE || config.cols > GAME_MAX_SIZE ||
+        config.plies < 1 || config.margin < 0 || config.margin >= UINT16_MAX || config.hash_mb < 1) {
+        Bookgen_Usage(argv[0]);
+        return 1;
+    }
+
+    uint64_t start = Timer_NowNs();
+    BookgenJob job;
+    job.config = &config;
+    uint64_t *positions = Bookgen_Enumerate(&config, &job.count);
+    job.positions = positions;
+    job.next = 0;
+    job.entries = malloc(job.count * sizeof(BookEntry));
+    job.kept = malloc(job.count * sizeof(bool));
+
+    ThreadPool pool;
+    ThreadPool_Init(&pool, threads);
+    job.workers = calloc(pool.num_threads, sizeof(BookgenWorker));
+    for (int i = 0; i < pool.num_threads; i++) {
+        BookgenWorker *w = &job.workers[i];
+        Grid_Init(&w->grid, config.rows, config.cols);
+        TT_Init(&w->tt, config.hash_mb);
+        Endgame_Init(&w->endgame);
+        w->moves = malloc(w->grid.num_edges * sizeof(BookgenMove));
+        w->child_keys = malloc(w->grid.num_edges * sizeof(uint64_t));
+    }
+    job.edge_words = job.workers[0].grid.edge_words;
+    ThreadPool_Run(&pool, Bookgen_Worker, &job);
+
+    int64_t nodes = 0;
+    for (int i = 0; i < pool.num_threads; i++) {
+        BookgenWorker *w = &job.workers[i];
+        nodes += w->nodes;
+        Grid_Free(&w->grid);
+        TT_Free(&w->tt);
+        Search_FreeScratch(&w->scratch);
+        Endgame_Free(&w->endgame);
+        free(w->moves);
+        free(w->child_keys);
+    }
+    int kept = 0;
+    for (int i = 0; i < job.count; i++) {
+        if (job.kept[i]) job.entries[kept++] = job.entries[i];
+    }
+    bool ok = Bookgen_Write(path, &config, job.entries, kept);
+    fprintf(stderr, "%dx%d: %d positions of under %d plies, %d booked, %lld nodes, %.1f s\n", config.rows,
+            config.cols, job.count, config.plies, kept, (long long)nodes, Timer_ElapsedMs(start) / 1000.0);
+
+    free(job.workers);
+    free(job.entries);
+    free(job.kept);
+    free(positions);
+    ThreadPool_Free(&pool);
+    return ok ? 0 : 1;
+}
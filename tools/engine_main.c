@@ -0,0 +1,8 @@
+#include "engine.h"
+#include <stdio.h>
+
+// The engine protocol (see engine.h) without the raylib front end, for
+// servers and analysis tools.
+int main(void) {
+    return Engine_Run(stdin, stdout);
+}
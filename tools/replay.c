@@ -0,0 +1,123 @@
+#define _POSIX_C_SOURCE 200809L
+#include "grid.h"
+#include "record.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Replays a game-record file through the Grid rules, checking every move,
+// and reports results and throughput. With -g it prints one game instead.
+
+typedef struct {
+    Grid empty;             // blank board copied over `board` before each game
+    Grid board;
+    bool ready;
+} ReplayBoard;
+
+static Grid *Replay_Board(ReplayBoard *rb, int rows, int cols) {
+    if (rb->ready && (rb->empty.rows != rows || rb->empty.cols != cols)) {
+        Grid_Free(&rb->empty);
+        Grid_Free(&rb->board);
+        rb->ready = false;
+    }
+    if (!rb->ready) {
+        Grid_Init(&rb->empty, rows, cols);
+        Grid_Init(&rb->board, rows, cols);
+        rb->ready = true;
+    }
+    Grid_CopyInto(&rb->board, &rb->empty);
+    return &rb->board;
+}
+
+static int Replay_Print(const RecordReader *reader, uint64_t index) {
+    RecordGame game;
+    if (!RecordReader_Game(reader, index, &game)) {
+        fprintf(stderr, "no game %llu\n", (unsigned long long)index);
+        return 1;
+    }
+    printf("game %llu: %dx%d, %d moves\n", (unsigned long long)index, game.rows, game.cols, game.num_moves);
+    RecordGame moves = game;
+    for (int i = 0; i < game.num_moves; i++) {
+        printf("%d%c", RecordGame_Next(&moves), i + 1 < game.num_moves ? ' ' : '\n');
+    }
+
+    ReplayBoard rb = { .ready = false };
+    Grid *g = Replay_Board(&rb, game.rows, game.cols);
+    bool ok = Record_Replay(&game, g);
+    printf("%s, score %d-%d\n", ok ? "legal" : "corrupt", g->claimed[0], g->claimed[1]);
+    Grid_Free(&rb.empty);
+    Grid_Free(&rb.board);
+    return ok ? 0 : 1;
+}
+
+static void Replay_Usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-g game] file\n", prog);
+}
+
+int main(int argc, char **argv) {
+    long long show = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "g:h")) != -1) {
+        switch (opt) {
+            case 'g': show = atoll(optarg); break;
+            default:
+                Replay_Usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1) {
+        Replay_Usage(argv[0]);
+        return 1;
+    }
+
+    uint64_t start = Timer_NowNs();
+    RecordReader reader;
+    if (!RecordReader_Open(&reader, argv[optind])) {
+        fprintf(stderr, "cannot open game records '%s'\n", argv[optind]);
+        return 1;
+    }
+    double index_ms = Timer_ElapsedMs(start);
+    if (show >= 0) {
+        int status = Replay_Print(&reader, (uint64_t)show);
+        RecordReader_Close(&reader);
+        return status;
+    }
+
+    ReplayBoard rb = { .ready = false };
+    long long wins[2] = { 0, 0 };
+    long long draws = 0, moves = 0, corrupt = 0;
+    start = Timer_NowNs();
+    for (uint64_t i = 0; i < reader.num_games; i++) {
+        RecordGame game;
+        if (!RecordReader_Game(&reader, i, &game)) {
+            corrupt++;
+            continue;
+        }
+        Grid *g = Replay_Board(&rb, game.rows, game.cols);
+        if (!Record_Replay(&game, g)) {
+            corrupt++;
+            continue;
+        }
+        moves += game.num_moves;
+        if (g->claimed[0] > g->claimed[1]) wins[0]++;
+        else if (g->claimed[1] > g->claimed[0]) wins[1]++;
+        else draws++;
+    }
+    double seconds = Timer_ElapsedMs(start) / 1000.0;
+
+    printf("%llu games, %lld moves, %lld corrupt, %.1f MB (indexed in %.1f ms)\n",
+           (unsigned long long)reader.num_games, moves, corrupt, reader.map_size / 1e6, index_ms);
+    printf("first player: %lld wins, second player: %lld wins, %lld draws\n", wins[0], wins[1], draws);
+    if (seconds > 0) {
+        printf("%.3f s, %.0f games/s, %.0f moves/s, %.1f MB/s\n", seconds, reader.num_games / seconds,
+               moves / seconds, reader.map_size / 1e6 / seconds);
+    }
+
+    if (rb.ready) {
+        Grid_Free(&rb.empty);
+        Grid_Free(&rb.board);
+    }
+    RecordReader_Close(&reader);
+    return corrupt ? 1 : 0;
+}
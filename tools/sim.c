@@ -0,0 +1,261 @@
+#define _POSIX_C_SOURCE 200809L
+#include "ai.h"
+#include "book.h"
+#include "box.h"
+#include "grid.h"
+#include "player.h"
+#include "record.h"
+#include "tablebase.h"
+#include "telemetry.h"
+#include "timer.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Headless self-play: plays N games between two AI levels on every core and
+// reports throughput and results. Engine A moves first in even-numbered
+// games and second in odd-numbered ones.
+
+typedef struct {
+    int games;
+    int rows;
+    int cols;
+    int threads;
+    uint64_t seed;
+    AIDifficulty level[2];
+    SearchLimits hard_limits;
+    MctsLimits mcts_limits;
+    int mcts_threads;
+    const Tablebase *tablebase;
+    const Book *book;
+    RecordWriter *records;  // every finished game is appended when set
+} SimConfig;
+
+typedef struct {
+    long long wins[2];      // by engine, not by seat
+    long long draws;
+    long long margin;       // engine A boxes minus engine B boxes
+    long long moves;
+} SimStats;
+
+typedef struct {
+    const SimConfig *config;
+    int *next_game;
+    SimStats stats;
+} SimWorker;
+
+static const char *level_names[] = { "random", "easy", "medium", "hard", "mcts" };
+
+static bool Sim_ParseLevel(const char *name, AIDifficulty *level) {
+    for (int i = 0; i < (int)(sizeof(level_names) / sizeof(level_names[0])); i++) {
+        if (strcmp(name, level_names[i]) == 0) {
+            *level = (AIDifficulty)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void Sim_PlayGame(const SimConfig *config, AIContext *ai, int index, SimStats *stats,
+                         RecordBuffer *record) {
+    Grid grid;
+    Grid_Init(&grid, config->rows, config->cols);
+    RecordBuffer_Begin(record, config->rows, config->cols);
+    // Reseeding per game keeps results independent of thread scheduling.
+    Rng_Seed(&ai->rng, config->seed + (uint64_t)index * 0x9E3779B97F4A7C15ull);
+
+    int first = index & 1;  // engine that owns seat 0
+    int player = 0;
+    while (!Game_IsOver(&grid)) {
+        int engine = player == 0 ? first : 1 - first;
+        int edge = AI_ChooseMove(ai, &grid, player, config->level[engine]);
+        if (edge < 0) break;
+        Grid_set_edge(&grid, edge);
+        int claimed = Box_CheckAndClaimAfterEdge(&grid, edge, player);
+        stats->moves++;
+        RecordBuffer_Move(record, edge);
+        if (Player_ShouldSwitch(claimed)) player = 1 - player;
+    }
+
+    int a_score = grid.claimed[first];
+    int b_score = grid.claimed[1 - first];
+    if (a_score > b_score) stats->wins[0]++;
+    else if (b_score > a_score) stats->wins[1]++;
+    else stats->draws++;
+    stats->margin += a_score - b_score;
+    if (config->records) RecordWriter_Append(config->records, record);
+    Grid_Free(&grid);
+}
+
+static void *Sim_Worker(void *arg) {
+    SimWorker *worker = arg;
+    const SimConfig *config = worker->config;
+    AIContext ai;
+    AI_Init(&ai, config->seed);
+    ai.hard_limits = config->hard_limits;
+    ai.mcts_limits = config->mcts_limits;
+    ai.mcts_threads = config->mcts_threads;
+    ai.tablebase = config->tablebase;
+    ai.book = config->book;
+    RecordBuffer record;
+    RecordBuffer_Init(&record);
+
+    for (;;) {
+        int index = __atomic_fetch_add(worker->next_game, 1, __ATOMIC_RELAXED);
+        if (index >= config->games) break;
+        Sim_PlayGame(config, &ai, index, &worker->stats, &record);
+    }
+
+    RecordBuffer_Free(&record);
+    AI_Free(&ai);
+    return NULL;
+}
+
+static void Sim_Usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-n games] [-a level] [-b level] [-r rows] [-c cols]\n"
+            "          [-t threads] [-s seed] [-T hard_ms] [-D hard_depth]\n"
+            "          [-M mcts_ms] [-P mcts_playouts] [-m mcts_threads] [-B tablebase]\n"
+            "          [-K book] [-o records] [-J telemetry.jsonl]\n"
+            "levels: random, easy, medium, hard, mcts\n", prog);
+}
+
+int main(int argc, char **argv) {
+    SimConfig config;
+    config.games = 1000;
+    config.rows = 5;
+    config.cols = 5;
+    config.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    config.seed = 1;
+    config.level[0] = AI_DIFFICULTY_MEDIUM;
+    config.level[1] = AI_DIFFICULTY_EASY;
+    config.hard_limits.max_depth = 0;
+    config.hard_limits.time_ms = 10;
+    config.hard_limits.max_nodes = 0;
+    config.hard_limits.stop = NULL;
+    config.hard_limits.info = NULL;
+    config.hard_limits.endgame = NULL;
+    config.mcts_limits.time_ms = 0;
+    config.mcts_limits.max_playouts = 20000;
+    config.mcts_limits.rollout_level = AI_DIFFICULTY_MEDIUM;
+    config.mcts_limits.exploration = 1.0;
+    config.mcts_limits.stop = NULL;
+    // Games already run one per core, so each MCTS search gets one thread.
+    config.mcts_threads = 1;
+    config.tablebase = NULL;
+    config.book = NULL;
+    config.records = NULL;
+    Tablebase tablebase;
+    Book book;
+    RecordWriter records;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:a:b:r:c:t:s:T:D:M:P:m:B:K:o:J:h")) != -1) {
+        switch (opt) {
+            case 'n': config.games = atoi(optarg); break;
+            case 'r': config.rows = atoi(optarg); break;
+            case 'c': config.cols = atoi(optarg); break;
+            case 't': config.threads = atoi(optarg); break;
+            case 's': config.seed = strtoull(optarg, NULL, 10); break;
+            case 'T': config.hard_limits.time_ms = atoi(optarg); break;
+            case 'D': config.hard_limits.max_depth = atoi(optarg); break;
+            case 'M': config.mcts_limits.time_ms = atoi(optarg); break;
+            case 'P': config.mcts_limits.max_playouts = atoll(optarg); break;
+            case 'm': config.mcts_threads = atoi(optarg); break;
+            case 'B':
+                if (!Tablebase_Open(&tablebase, optarg)) {
+                    fprintf(stderr, "cannot open tablebase '%s'\n", optarg);
+                    return 1;
+                }
+                config.tablebase = &tablebase;
+                break;
+            case 'K':
+                if (!Book_Open(&book, optarg)) {
+                    fprintf(stderr, "cannot open book '%s'\n", optarg);
+                    return 1;
+                }
+                config.book = &book;
+                break;
+            case 'o':
+                if (!RecordWriter_Open(&records, optarg)) {
+                    fprintf(stderr, "cannot append game records to '%s'\n", optarg);
+                    return 1;
+                }
+                config.records = &records;
+                break;
+            case 'J':
+#if TELEMETRY_ENABLED
+                if (!Telemetry_OpenSink(optarg)) {
+                    fprintf(stderr, "cannot write telemetry to '%s'\n", optarg);
+                    return 1;
+                }
+#else
+                fprintf(stderr, "built without telemetry; ignoring -J\n");
+#endif
+                break;
+            case 'a':
+            case 'b':
+                if (!Sim_ParseLevel(optarg, &config.level[opt == 'a' ? 0 : 1])) {
+                    fprintf(stderr, "unknown level '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                Sim_Usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (config.threads < 1) config.threads = 1;
+    if (config.games < 1 || config.rows < 1 || config.cols < 1) {
+        Sim_Usage(argv[0]);
+        return 1;
+    }
+
+    SimWorker *workers = calloc(config.threads, sizeof(SimWorker));
+    pthread_t *threads = malloc(config.threads * sizeof(pthread_t));
+    int next_game = 0;
+
+    uint64_t start = Timer_NowNs();
+    for (int i = 0; i < config.threads; i++) {
+        workers[i].config = &config;
+        workers[i].next_game = &next_game;
+        pthread_create(&threads[i], NULL, Sim_Worker, &workers[i]);
+    }
+
+    SimStats total;
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < config.threads; i++) {
+        pthread_join(threads[i], NULL);
+        total.wins[0] += workers[i].stats.wins[0];
+        total.wins[1] += workers[i].stats.wins[1];
+        total.draws += workers[i].stats.draws;
+        total.margin += workers[i].stats.margin;
+        total.moves += workers[i].stats.moves;
+    }
+    double seconds = Timer_ElapsedMs(start) / 1000.0;
+
+    printf("%d games on %dx%d, %d threads, seed %llu\n", config.games, config.rows, config.cols,
+           config.threads, (unsigned long long)config.seed);
+    printf("A (%s): %lld wins (%.1f%%)\n", level_names[config.level[0]], total.wins[0],
+           100.0 * total.wins[0] / config.games);
+    printf("B (%s): %lld wins (%.1f%%)\n", level_names[config.level[1]], total.wins[1],
+           100.0 * total.wins[1] / config.games);
+    printf("draws: %lld (%.1f%%)\n", total.draws, 100.0 * total.draws / config.games);
+    printf("mean margin A-B: %+.2f boxes\n", (double)total.margin / config.games);
+    printf("%.2f s, %.1f games/s, %.0f moves/s\n", seconds, config.games / seconds, total.moves / seconds);
+
+    free(workers);
+    free(threads);
+    if (config.tablebase) Tablebase_Close(&tablebase);
+    if (config.book) Book_Close(&book);
+#if TELEMETRY_ENABLED
+    Telemetry_Close();
+#endif
+    if (config.records && !RecordWriter_Close(&records)) {
+        perror("game records");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,347 @@
+#define _POSIX_C_SOURCE 200809L
+#include "endgame.h"
+#include "game.h"
+#include "grid.h"
+#include "search.h"
+#include "tablebase.h"
+#include "threadpool.h"
+#include "timer.h"
+#include "ttable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Batch solver: reads positions, one per line,
+//   rows cols edges turn score0 score1
+// where `edges` has one '0' or '1' per edge in Grid index order, and writes
+// one result per position in input order:
+//   line value move exact depth nodes final
+// `value` is what the side to move gains from here on (its boxes minus the
+// opponent's), `final` the margin it ends the game with, and `exact` 1 when
+// the value is proven: by the tablebase, by the chain-and-loop endgame solver
+// or by a search that reached the end of every line. Blank lines and lines starting
+// with '#' are skipped; a position that does not parse gets "line error
+// MESSAGE" instead.
+//
+// Positions are solved a batch at a time on a thread pool. Each worker
+// starts with an equal slice of the batch and, once it runs dry, steals the
+// upper half of the largest slice left, so a few slow positions do not hold
+// the rest of the pool idle.
+
+#define SOLVE_BATCH 4096
+
+typedef struct {
+    int value;
+    int move;
+    int exact;
+    int depth;
+    int64_t nodes;
+    int final;
+    const char *error;
+} SolveResult;
+
+typedef struct {
+    SearchLimits limits;
+    size_t hash_mb;
+    const Tablebase *tablebase;
+} SolveConfig;
+
+// One worker's search state, kept from batch to batch.
+typedef struct {
+    Grid grid;
+    bool has_grid;
+    uint64_t *edges;
+    int edge_words;
+    TTable tt;
+    SearchScratch scratch;
+    Endgame endgame;        // unlike the TT, valid for every board size
+    // Slice [begin, end) of the batch, as begin | end << 32, claimed from
+    // the front by the owner and split from the back by thieves.
+    uint64_t range;
+    int64_t nodes;
+    int64_t exact;
+} SolveWorker;
+
+typedef struct {
+    const SolveConfig *config;
+    SolveWorker *workers;
+    int num_workers;
+    char **lines;
+    SolveResult *results;
+} SolveJob;
+
+static inline uint64_t Solve_Range(uint32_t begin, uint32_t end) {
+    return begin | (uint64_t)end << 32;
+}
+
+// Next position of the worker's own slice, or -1 once it is empty.
+static int Solve_Take(SolveWorker *w) {
+    uint64_t range = __atomic_load_n(&w->range, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t begin = (uint32_t)range, end = (uint32_t)(range >> 32);
+        if (begin >= end) return -1;
+        if (__atomic_compare_exchange_n(&w->range, &range, Solve_Range(begin + 1, end), false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return (int)begin;
+        }
+    }
+}
+
+// Moves the back half of the fullest other slice into `self`. False when
+// every slice is empty.
+static bool Solve_Steal(SolveJob *job, SolveWorker *self) {
+    for (;;) {
+        SolveWorker *victim = NULL;
+        uint64_t range = 0;
+        uint32_t most = 0;
+        for (int i = 0; i < job->num_workers; i++) {
+            uint64_t r = __atomic_load_n(&job->workers[i].range, __ATOMIC_ACQUIRE);
+            uint32_t left = (uint32_t)(r >> 32) - (uint32_t)r;
+            if ((uint32_t)(r >> 32) > (uint32_t)r && left > most) {
+                victim = &job->workers[i];
+                range = r;
+                most = left;
+            }
+        }
+        if (!victim) return false;
+        uint32_t begin = (uint32_t)range, end = (uint32_t)(range >> 32);
+        uint32_t mid = begin + (end - begin) / 2;
+        if (__atomic_compare_exchange_n(&victim->range, &range, Solve_Range(begin, mid), false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&self->range, Solve_Range(mid, end), __ATOMIC_RELEASE);
+            return true;
+        }
+    }
+}
+
+// Loads "rows cols edges turn score0 score1" into the worker's grid.
+static const char *Solve_Parse(SolveWorker *w, const char *line, int *turn, int score[2]) {
+    int rows, cols, used;
+    if (sscanf(line, "%d %d %n", &rows, &cols, &used) != 2) return "expected rows and cols";
+    if (rows < 1 || cols < 1 || rows > GAME_MAX_SIZE || cols > GAME_MAX_SIZE) return "bad board size";
+    if (w->has_grid && (w->grid.rows != rows || w->grid.cols != cols)) {
+        Grid_Free(&w->grid);
+        w->has_grid = false;
+        // Hashes do not encode the board size.
+        if (w->tt.buckets) TT_Clear(&w->tt);
+    }
+    if (!w->has_grid) {
+        Grid_Init(&w->grid, rows, cols);
+        w->has_grid = true;
+        if (w->edge_words < w->grid.edge_words) {
+            free(w->edges);
+            w->edge_words = w->grid.edge_words;
+            w->edges = malloc(w->edge_words * sizeof(uint64_t));
+        }
+    }
+    Grid *g = &w->grid;
+
+    const char *bits = line + used;
+    memset(w->edges, 0, g->edge_words * sizeof(uint64_t));
+    for (int e = 0; e < g->num_edges; e++) {
+        if (bits[e] == '1') Bitset_Set(w->edges, e);
+        else if (bits[e] != '0') return "edges must be one 0 or 1 per edge";
+    }
+    if (sscanf(bits + g->num_edges, "%d %d %d", turn, &score[0], &score[1]) != 3) {
+        return "expected turn and both scores after the edges";
+    }
+    if (*turn < 0 || *turn > 1 || score[0] < 0 || score[1] < 0) return "bad turn or score";
+
+    Grid_SetPosition(g, w->edges, NULL);
+    if (score[0] + score[1] != g->claimed_total) return "scores do not add up to the complete boxes";
+    // Only the edges matter to the search; the scores go into `final`.
+    return NULL;
+}
+
+static void Solve_One(const SolveConfig *config, SolveWorker *w, const char *line, SolveResult *out) {
+    int turn, score[2];
+    memset(out, 0, sizeof(*out));
+    out->move = -1;
+    out->error = Solve_Parse(w, line, &turn, score);
+    if (out->error) return;
+    Grid *g = &w->grid;
+
+    int remaining = g->num_open;
+    if (config->tablebase && Tablebase_Value(config->tablebase, g, &out->value)) {
+        out->move = Tablebase_BestMove(config->tablebase, g);
+        out->exact = 1;
+        out->depth = remaining;
+    } else if ((out->move = Endgame_BestMove(&w->endgame, g, &out->value)) >= 0) {
+        out->exact = 1;
+        out->depth = remaining;
+    } else {
+        if (!w->tt.buckets) TT_Init(&w->tt, config->hash_mb);
+        SearchLimits limits = config->limits;
+        limits.endgame = &w->endgame;
+        SearchResult result = Search_BestMove(g, turn, &limits, w->tt.buckets ? &w->tt : NULL, &w->scratch);
+        out->value = result.score;
+        out->move = result.move;
+        out->depth = result.depth;
+        out->nodes = result.nodes;
+        out->exact = result.depth >= remaining;
+    }
+    out->final = score[turn] - score[1 - turn] + out->value;
+    w->nodes += out->nodes;
+    w->exact += out->exact;
+}
+
+static void Solve_Worker(void *arg, int worker) {
+    SolveJob *job = arg;
+    SolveWorker *w = &job->workers[worker];
+    for (;;) {
+        int index = Solve_Take(w);
+        if (index < 0) {
+            if (!Solve_Steal(job, w)) break;
+            continue;
+        }
+        Solve_One(job->config, w, job->lines[index], &job->results[index]);
+    }
+}
+
+static bool Solve_Skip(const char *line) {
+    line += strspn(line, " \t\r\n");
+    return *line == '\0' || *line == '#';
+}
+
+static void Solve_Usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-i positions] [-o results] [-N nodes] [-D depth] [-T ms]\n"
+            "          [-t threads] [-H hash_mb] [-B tablebase]\n"
+            "input lines: rows cols edges turn score0 score1 (edges as 0/1 per edge)\n"
+            "output lines: line value move exact depth nodes final\n"
+            "limits apply per position; with none every position is solved exactly\n", prog);
+}
+
+int main(int argc, char **argv) {
+    SolveConfig config;
+    config.limits.max_depth = 0;
+    config.limits.time_ms = 0;
+    config.limits.max_nodes = 0;
+    config.limits.stop = NULL;
+    config.limits.info = NULL;
+    config.limits.endgame = NULL;
+    config.hash_mb = 16;
+    config.tablebase = NULL;
+    const char *in_path = NULL;
+    const char *out_path = NULL;
+    int threads = 0;
+    Tablebase tablebase;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:o:N:D:T:t:H:B:h")) != -1) {
+        switch (opt) {
+            case 'i': in_path = optarg; break;
+            case 'o': out_path = optarg; break;
+            case 'N': config.limits.max_nodes = atoll(optarg); break;
+            case 'D': config.limits.max_depth = atoi(optarg); break;
+            case 'T': config.limits.time_ms = atoi(optarg); break;
+            case 't': threads = atoi(optarg); break;
+            case 'H': config.hash_mb = (size_t)atoi(optarg); break;
+            case 'B':
+                if (!Tablebase_Open(&tablebase, optarg)) {
+                    fprintf(stderr, "cannot open tablebase '%s'\n", optarg);
+                    return 1;
+                }
+                config.tablebase = &tablebase;
+                break;
+            default:
+                Solve_Usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (config.hash_mb < 1) config.hash_mb = 1;
+    FILE *in = in_path ? fopen(in_path, "r") : stdin;
+    if (!in) {
+        perror(in_path);
+        return 1;
+    }
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        perror(out_path);
+        return 1;
+    }
+
+    ThreadPool pool;
+    ThreadPool_Init(&pool, threads);
+    SolveJob job;
+    job.config = &config;
+    job.num_workers = pool.num_threads;
+    job.workers = calloc(job.num_workers, sizeof(SolveWorker));
+    job.lines = calloc(SOLVE_BATCH, sizeof(char *));
+    job.results = malloc(SOLVE_BATCH * sizeof(SolveResult));
+    size_t *caps = calloc(SOLVE_BATCH, sizeof(size_t));
+    long long *line_numbers = malloc(SOLVE_BATCH * sizeof(long long));
+
+    uint64_t start = Timer_NowNs();
+    long long line_number = 0, positions = 0, errors = 0;
+    bool eof = false;
+    while (!eof) {
+        int count = 0;
+        while (count < SOLVE_BATCH) {
+            if (getline(&job.lines[count], &caps[count], in) < 0) {
+                eof = true;
+                break;
+            }
+            line_number++;
+            if (Solve_Skip(job.lines[count])) continue;
+            line_numbers[count++] = line_number;
+        }
+        if (count == 0) break;
+
+        for (int i = 0; i < job.num_workers; i++) {
+            uint32_t begin = (uint32_t)((int64_t)count * i / job.num_workers);
+            uint32_t end = (uint32_t)((int64_t)count * (i + 1) / job.num_workers);
+            job.workers[i].range = Solve_Range(begin, end);
+        }
+        ThreadPool_Run(&pool, Solve_Worker, &job);
+
+        for (int i = 0; i < count; i++) {
+            const SolveResult *r = &job.results[i];
+            if (r->error) {
+                fprintf(out, "%lld error %s\n", line_numbers[i], r->error);
+                errors++;
+            } else {
+                fprintf(out, "%lld %d %d %d %d %lld %d\n", line_numbers[i], r->value, r->move, r->exact,
+                        r->depth, (long long)r->nodes, r->final);
+            }
+        }
+        fflush(out);
+        positions += count;
+    }
+    double seconds = Timer_ElapsedMs(start) / 1000.0;
+
+    int64_t nodes = 0, exact = 0;
+    for (int i = 0; i < job.num_workers; i++) {
+        SolveWorker *w = &job.workers[i];
+        nodes += w->nodes;
+        exact += w->exact;
+        if (w->has_grid) Grid_Free(&w->grid);
+        free(w->edges);
+        TT_Free(&w->tt);
+        Search_FreeScratch(&w->scratch);
+        Endgame_Free(&w->endgame);
+    }
+    fprintf(stderr, "%lld positions (%lld exact, %lld errors) on %d threads in %.2f s\n", positions,
+            (long long)exact, errors, job.num_workers, seconds);
+    if (seconds > 0) {
+        fprintf(stderr, "%.1f positions/s, %.0f nodes/s\n", positions / seconds, nodes / seconds);
+    }
+
+    for (int i = 0; i < SOLVE_BATCH; i++) {
+        free(job.lines[i]);
+    }
+    free(job.lines);
+    free(job.results);
+    free(caps);
+    free(line_numbers);
+    free(job.workers);
+    ThreadPool_Free(&pool);
+    if (config.tablebase) Tablebase_Close(&tablebase);
+    if (in != stdin) fclose(in);
+    if (out != stdout && fclose(out) != 0) {
+        perror(out_path);
+        return 1;
+    }
+    return 0;
+}
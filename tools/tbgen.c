@@ -0,0 +1,185 @@
+#define _POSIX_C_SOURCE 200809L
+#include "grid.h"
+#include "tablebase.h"
+#include "threadpool.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Builds the endgame tablebase by retrograde analysis. A position's value
+// only depends on positions with one more edge drawn, whose edge sets are
+// larger numbers, so one pass from the full set down to the empty set sees
+// every child first.
+//
+// For the thread pool the sets are cut into blocks by their top TBGEN_PREFIX
+// bits. Children of a block's sets lie in the same block or in one whose
+// prefix has one more bit set, so the blocks are solved in stages by the
+// popcount of their prefix, each block walked downwards by a single worker.
+#define TBGEN_PREFIX 10
+
+typedef struct {
+    int num_edges;
+    uint64_t full;
+    uint64_t (*box_masks)[2];  // per edge: the edge sets of its (up to) two boxes
+    int8_t *values;
+    int low_bits;               // edges below the block prefix
+    int stage;                  // popcount of the prefixes being solved
+    int threads;
+} TbgenJob;
+
+static void Tbgen_BuildMasks(const Grid *g, uint64_t (*box_masks)[2]) {
+    for (int e = 0; e < g->num_edges; e++) {
+        const int *boxes = Grid_edge_boxes(g, e);
+        for (int i = 0; i < 2; i++) {
+            box_masks[e][i] = 0;
+            if (boxes[i] < 0) continue;
+            int r = boxes[i] / g->cols;
+            int c = boxes[i] % g->cols;
+            box_masks[e][i] = (uint64_t)1 << Grid_index_h(g, r, c) |
+                              (uint64_t)1 << Grid_index_h(g, r + 1, c) |
+                              (uint64_t)1 << Grid_index_v(g, r, c) |
+                              (uint64_t)1 << Grid_index_v(g, r, c + 1);
+        }
+    }
+}
+
+static int Tbgen_Solve(const TbgenJob *job, uint64_t set) {
+    uint64_t open = ~set & job->full;
+    if (!open) return 0;
+    int best = -TABLEBASE_MAX_EDGES;
+    while (open) {
+        int edge = __builtin_ctzll(open);
+        open &= open - 1;
+        uint64_t next = set | (uint64_t)1 << edge;
+        int captures = 0;
+        for (int i = 0; i < 2; i++) {
+            uint64_t mask = job->box_masks[edge][i];
+            if (mask && (next & mask) == mask) captures++;
+        }
+        int child = job->values[next];
+        int value = captures ? captures + child : -child;
+        if (value > best) best = value;
+    }
+    return best;
+}
+
+static void Tbgen_Stage(void *arg, int worker) {
+    TbgenJob *job = arg;
+    uint64_t block = (uint64_t)1 << job->low_bits;
+    uint64_t prefixes = (job->full >> job->low_bits) + 1;
+    int n = 0;
+    for (uint64_t prefix = 0; prefix < prefixes; prefix++) {
+        if (__builtin_popcountll(prefix) != job->stage) continue;
+        if (n++ % job->threads != worker) continue;
+        uint64_t base = prefix << job->low_bits;
+        for (uint64_t low = block; low-- > 0;) {
+            job->values[base | low] = (int8_t)Tbgen_Solve(job, base | low);
+        }
+    }
+}
+
+static int8_t *Tbgen_Build(ThreadPool *pool, int rows, int cols) {
+    Grid g;
+    Grid_Init(&g, rows, cols);
+    TbgenJob job;
+    job.num_edges = g.num_edges;
+    job.full = ((uint64_t)1 << g.num_edges) - 1;
+    job.box_masks = malloc(g.num_edges * sizeof(*job.box_masks));
+    job.values = malloc((size_t)1 << g.num_edges);
+    job.threads = pool->num_threads;
+    Tbgen_BuildMasks(&g, job.box_masks);
+
+    int prefix_bits = g.num_edges < TBGEN_PREFIX ? g.num_edges : TBGEN_PREFIX;
+    job.low_bits = g.num_edges - prefix_bits;
+    for (job.stage = prefix_bits; job.stage >= 0; job.stage--) {
+        ThreadPool_Run(pool, Tbgen_Stage, &job);
+    }
+
+    free(job.box_masks);
+    Grid_Free(&g);
+    return job.values;
+}
+
+static void Tbgen_Usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-o file] [-n max_size] [-t threads]\n"
+            "builds tables for every board up to max_size x max_size (default 3)\n"
+            "with at most %d edges\n", prog, TABLEBASE_MAX_EDGES);
+}
+
+int main(int argc, char **argv) {
+    const char *path = TABLEBASE_PATH;
+    int max_size = 3;
+    int threads = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "o:n:t:h")) != -1) {
+        switch (opt) {
+            case 'o': path = optarg; break;
+            case 'n': max_size = atoi(optarg); break;
+            case 't': threads = atoi(optarg); break;
+            default:
+                Tbgen_Usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    TablebaseDir dir[64];
+    int num_tables = 0;
+    for (int rows = 1; rows <= max_size; rows++) {
+        for (int cols = 1; cols <= max_size; cols++) {
+            int edges = (rows + 1) * cols + rows * (cols + 1);
+            if (edges > TABLEBASE_MAX_EDGES || num_tables == 64) continue;
+            dir[num_tables].rows = rows;
+            dir[num_tables].cols = cols;
+            dir[num_tables].size = (uint64_t)1 << edges;
+            num_tables++;
+        }
+    }
+    if (num_tables == 0) {
+        Tbgen_Usage(argv[0]);
+        return 1;
+    }
+
+    // Tables start on 64-byte boundaries after the directory.
+    uint64_t offset = sizeof(TablebaseHeader) + num_tables * sizeof(TablebaseDir);
+    for (int i = 0; i < num_tables; i++) {
+        offset = (offset + 63) & ~(uint64_t)63;
+        dir[i].offset = offset;
+        offset += dir[i].size;
+    }
+
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        perror(path);
+        return 1;
+    }
+    TablebaseHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TABLEBASE_MAGIC, sizeof(header.magic));
+    header.version = TABLEBASE_VERSION;
+    header.num_tables = num_tables;
+    fwrite(&header, sizeof(header), 1, out);
+    fwrite(dir, sizeof(TablebaseDir), num_tables, out);
+
+    ThreadPool pool;
+    ThreadPool_Init(&pool, threads);
+    for (int i = 0; i < num_tables; i++) {
+        uint64_t start = Timer_NowNs();
+        int8_t *values = Tbgen_Build(&pool, dir[i].rows, dir[i].cols);
+        fseek(out, (long)dir[i].offset, SEEK_SET);
+        fwrite(values, 1, dir[i].size, out);
+        fprintf(stderr, "%dx%d: %llu positions, empty board %+d, %.1f ms\n", dir[i].rows, dir[i].cols,
+                (unsigned long long)dir[i].size, values[0], Timer_ElapsedMs(start));
+        free(values);
+    }
+    ThreadPool_Free(&pool);
+
+    if (fclose(out) != 0) {
+        perror(path);
+        return 1;
+    }
+    return 0;
+}
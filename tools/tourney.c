@@ -0,0 +1,353 @@
+#define _POSIX_C_SOURCE 200809L
+#include "ai.h"
+#include "grid.h"
+#include "movestack.h"
+#include "player.h"
+#include "record.h"
+#include "tablebase.h"
+#include "timer.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Round-robin tournament between AI levels. Each match plays pairs of games
+// from a seeded random opening, one with each engine moving first, on every
+// core. A sequential probability ratio test between elo0 and elo1 ends a
+// match as soon as either hypothesis is accepted; otherwise it runs to the
+// game limit.
+
+#define TOURNEY_MAX_ENGINES 8
+
+typedef struct {
+    int max_games;          // per match, rounded up to whole pairs
+    int rows;
+    int cols;
+    int threads;
+    int opening_plies;
+    uint64_t seed;
+    double elo0, elo1;      // SPRT hypotheses, in Elo of the first engine
+    double alpha, beta;     // false positive and false negative rates
+    SearchLimits hard_limits;
+    MctsLimits mcts_limits;
+    const Tablebase *tablebase;
+    RecordWriter *records;
+} TourneyConfig;
+
+// Counts are from engine A's side.
+typedef struct {
+    int wins, draws, losses;
+} TourneyScore;
+
+typedef struct {
+    const TourneyConfig *config;
+    AIDifficulty engine[2];
+    pthread_mutex_t lock;
+    int next_game;
+    bool stopped;           // no new games once the SPRT has decided
+    int decision;           // +1 H1 accepted, -1 H0 accepted, 0 open
+    TourneyScore score;
+    long long moves;
+} TourneyMatch;
+
+static const char *level_names[] = { "random", "easy", "medium", "hard", "mcts" };
+
+static bool Tourney_ParseLevel(const char *name, AIDifficulty *level) {
+    for (int i = 0; i < (int)(sizeof(level_names) / sizeof(level_names[0])); i++) {
+        if (strcmp(name, level_names[i]) == 0) {
+            *level = (AIDifficulty)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static double Tourney_EloToScore(double elo) {
+    return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+static double Tourney_ScoreToElo(double score) {
+    if (score < 0.001) score = 0.001;
+    if (score > 0.999) score = 0.999;
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+// Mean score and its per-game variance, from (possibly fractional) counts.
+static void Tourney_Moments(double wins, double draws, double losses, double *mean, double *var) {
+    double n = wins + draws + losses;
+    double m = n > 0 ? (wins + 0.5 * draws) / n : 0.5;
+    *mean = m;
+    *var = n > 0 ? (wins * (1 - m) * (1 - m) + draws * (0.5 - m) * (0.5 - m) + losses * m * m) / n : 0.0;
+}
+
+// Log-likelihood ratio of elo1 against elo0, with the score distribution
+// approximated as normal. Half a game of each outcome is added so a
+// one-sided match still has a variance and can stop.
+static double Tourney_LLR(const TourneyConfig *config, const TourneyScore *s) {
+    double n = s->wins + s->draws + s->losses + 1.5;
+    double mean, var;
+    Tourney_Moments(s->wins + 0.5, s->draws + 0.5, s->losses + 0.5, &mean, &var);
+    double s0 = Tourney_EloToScore(config->elo0);
+    double s1 = Tourney_EloToScore(config->elo1);
+    return n * (s1 - s0) * (2 * mean - s0 - s1) / (2 * var);
+}
+
+// Random safe moves, so neither side starts out a box down. Safe moves never
+// complete a box, so the turn passes every ply.
+static void Tourney_PlayOpening(const TourneyConfig *config, Grid *g, MoveStack *moves, Rng *rng, int *player) {
+    for (int i = 0; i < config->opening_plies; i++) {
+        int safe = Grid_count_moves(g, MOVES_SAFE);
+        if (safe == 0) break;
+        MoveStack_Make(moves, g, Grid_nth_move(g, MOVES_SAFE, Rng_Range(rng, safe)), *player);
+        *player = 1 - *player;
+    }
+}
+
+// Plays game `index` of the match: pair index / 2 shares its opening, and
+// engine A takes seat 0 in even games. Returns engine A's boxes minus B's.
+static int Tourney_PlayGame(TourneyMatch *match, AIContext *ai, int index, Grid *g, MoveStack *moves,
+                            RecordBuffer *record, long long *num_moves) {
+    const TourneyConfig *config = match->config;
+    Grid_Init(g, config->rows, config->cols);
+    MoveStack_Clear(moves);
+    Rng opening;
+    Rng_Seed(&opening, config->seed + (uint64_t)(index / 2) * 0x9E3779B97F4A7C15ull);
+    Rng_Seed(&ai->rng, config->seed ^ ((uint64_t)index << 32));
+
+    int first = index & 1;  // engine in seat 0
+    int player = 0;
+    Tourney_PlayOpening(config, g, moves, &opening, &player);
+    while (!Game_IsOver(g)) {
+        int engine = player == 0 ? first : 1 - first;
+        int edge = AI_ChooseMove(ai, g, player, match->engine[engine]);
+        if (edge < 0) break;
+        if (Player_ShouldSwitch(MoveStack_Make(moves, g, edge, player))) player = 1 - player;
+    }
+
+    if (config->records) {
+        RecordBuffer_Begin(record, g->rows, g->cols);
+        for (int i = 0; i < moves->count; i++) {
+            RecordBuffer_Move(record, moves->moves[i].edge);
+        }
+        RecordWriter_Append(config->records, record);
+    }
+    *num_moves += moves->count;
+    int margin = g->claimed[first] - g->claimed[1 - first];
+    Grid_Free(g);
+    return margin;
+}
+
+static void *Tourney_Worker(void *arg) {
+    TourneyMatch *match = arg;
+    const TourneyConfig *config = match->config;
+    AIContext ai;
+    AI_Init(&ai, config->seed);
+    ai.hard_limits = config->hard_limits;
+    ai.mcts_limits = config->mcts_limits;
+    // Games already run one per core.
+    ai.mcts_threads = 1;
+    ai.tablebase = config->tablebase;
+    Grid g;
+    MoveStack moves;
+    Grid_Init(&g, config->rows, config->cols);
+    MoveStack_Init(&moves, g.num_edges);
+    Grid_Free(&g);
+    RecordBuffer record;
+    RecordBuffer_Init(&record);
+
+    double lower = log(config->beta / (1 - config->alpha));
+    double upper = log((1 - config->beta) / config->alpha);
+    for (;;) {
+        pthread_mutex_lock(&match->lock);
+        int index = match->next_game;
+        bool done = match->stopped || index >= config->max_games;
+        if (!done) match->next_game++;
+        pthread_mutex_unlock(&match->lock);
+        if (done) break;
+
+        long long num_moves = 0;
+        int margin = Tourney_PlayGame(match, &ai, index, &g, &moves, &record, &num_moves);
+
+        pthread_mutex_lock(&match->lock);
+        if (margin > 0) match->score.wins++;
+        else if (margin < 0) match->score.losses++;
+        else match->score.draws++;
+        match->moves += num_moves;
+        if (!match->stopped) {
+            double llr = Tourney_LLR(config, &match->score);
+            if (llr >= upper || llr <= lower) {
+                match->stopped = true;
+                match->decision = llr >= upper ? 1 : -1;
+            }
+        }
+        pthread_mutex_unlock(&match->lock);
+    }
+
+    RecordBuffer_Free(&record);
+    MoveStack_Free(&moves);
+    AI_Free(&ai);
+    return NULL;
+}
+
+static void Tourney_RunMatch(TourneyMatch *match) {
+    const TourneyConfig *config = match->config;
+    pthread_mutex_init(&match->lock, NULL);
+    match->next_game = 0;
+    match->stopped = false;
+    match->decision = 0;
+    memset(&match->score, 0, sizeof(match->score));
+    match->moves = 0;
+
+    pthread_t *threads = malloc(config->threads * sizeof(pthread_t));
+    for (int i = 0; i < config->threads; i++) {
+        pthread_create(&threads[i], NULL, Tourney_Worker, match);
+    }
+    for (int i = 0; i < config->threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&match->lock);
+}
+
+static void Tourney_Report(const TourneyConfig *config, const TourneyMatch *match, double seconds) {
+    const TourneyScore *s = &match->score;
+    int n = s->wins + s->draws + s->losses;
+    double mean, var;
+    Tourney_Moments(s->wins, s->draws, s->losses, &mean, &var);
+    // 95% interval of the mean score, mapped through the Elo curve.
+    double margin = n > 1 ? 1.96 * sqrt(var / n) : 0.5;
+    double elo = Tourney_ScoreToElo(mean);
+    double elo_lo = Tourney_ScoreToElo(mean - margin);
+    double elo_hi = Tourney_ScoreToElo(mean + margin);
+    const char *decision = match->decision > 0 ? "H1 accepted" : match->decision < 0 ? "H0 accepted" : "inconclusive";
+
+    printf("%-6s vs %-6s  +%d =%d -%d  score %5.1f%%  Elo %+7.1f [%+.1f, %+.1f]  LLR %+.2f (%s, %d games, %.1f s, %.0f moves/s)\n",
+           level_names[match->engine[0]], level_names[match->engine[1]], s->wins, s->draws, s->losses,
+           100.0 * mean, elo, elo_lo, elo_hi, Tourney_LLR(config, s), decision, n, seconds,
+           seconds > 0 ? match->moves / seconds : 0.0);
+}
+
+static void Tourney_Usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [-e level,level,...] [-n max_games] [-r rows] [-c cols]\n"
+            "          [-t threads] [-s seed] [-O opening_plies] [-0 elo0] [-1 elo1]\n"
+            "          [-a alpha] [-b beta] [-T hard_ms] [-D hard_depth] [-M mcts_ms]\n"
+            "          [-P mcts_playouts] [-B tablebase] [-o records]\n"
+            "levels: random, easy, medium, hard, mcts; every pair plays one match\n", prog);
+}
+
+int main(int argc, char **argv) {
+    TourneyConfig config;
+    config.max_games = 2000;
+    config.rows = 5;
+    config.cols = 5;
+    config.threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    config.opening_plies = 4;
+    config.seed = 1;
+    config.elo0 = 0.0;
+    config.elo1 = 20.0;
+    config.alpha = 0.05;
+    config.beta = 0.05;
+    config.hard_limits.max_depth = 0;
+    config.hard_limits.time_ms = 10;
+    config.hard_limits.max_nodes = 0;
+    config.hard_limits.stop = NULL;
+    config.hard_limits.info = NULL;
+    config.hard_limits.endgame = NULL;
+    config.mcts_limits.time_ms = 0;
+    config.mcts_limits.max_playouts = 20000;
+    config.mcts_limits.rollout_level = AI_DIFFICULTY_MEDIUM;
+    config.mcts_limits.exploration = 1.0;
+    config.mcts_limits.stop = NULL;
+    config.tablebase = NULL;
+    config.records = NULL;
+    Tablebase tablebase;
+    RecordWriter records;
+
+    AIDifficulty engines[TOURNEY_MAX_ENGINES] = { AI_DIFFICULTY_EASY, AI_DIFFICULTY_MEDIUM, AI_DIFFICULTY_HARD };
+    int num_engines = 3;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "e:n:r:c:t:s:O:0:1:a:b:T:D:M:P:B:o:h")) != -1) {
+        switch (opt) {
+            case 'e': {
+                num_engines = 0;
+                char *list = strdup(optarg);
+                for (char *name = strtok(list, ","); name; name = strtok(NULL, ",")) {
+                    if (num_engines == TOURNEY_MAX_ENGINES || !Tourney_ParseLevel(name, &engines[num_engines])) {
+                        fprintf(stderr, "unknown level '%s' or too many engines\n", name);
+                        return 1;
+                    }
+                    num_engines++;
+                }
+                free(list);
+                break;
+            }
+            case 'n': config.max_games = atoi(optarg); break;
+            case 'r': config.rows = atoi(optarg); break;
+            case 'c': config.cols = atoi(optarg); break;
+            case 't': config.threads = atoi(optarg); break;
+            case 's': config.seed = strtoull(optarg, NULL, 10); break;
+            case 'O': config.opening_plies = atoi(optarg); break;
+            case '0': config.elo0 = atof(optarg); break;
+            case '1': config.elo1 = atof(optarg); break;
+            case 'a': config.alpha = atof(optarg); break;
+            case 'b': config.beta = atof(optarg); break;
+            case 'T': config.hard_limits.time_ms = atoi(optarg); break;
+            case 'D': config.hard_limits.max_depth = atoi(optarg); break;
+            case 'M': config.mcts_limits.time_ms = atoi(optarg); break;
+            case 'P': config.mcts_limits.max_playouts = atoll(optarg); break;
+            case 'B':
+                if (!Tablebase_Open(&tablebase, optarg)) {
+                    fprintf(stderr, "cannot open tablebase '%s'\n", optarg);
+                    return 1;
+                }
+                config.tablebase = &tablebase;
+                break;
+            case 'o':
+                if (!RecordWriter_Open(&records, optarg)) {
+                    fprintf(stderr, "cannot append game records to '%s'\n", optarg);
+                    return 1;
+                }
+                config.records = &records;
+                break;
+            default:
+                Tourney_Usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (config.threads < 1) config.threads = 1;
+    config.max_games += config.max_games & 1;
+    if (num_engines < 2 || config.max_games < 2 || config.rows < 1 || config.cols < 1 ||
+        config.alpha <= 0 || config.alpha >= 1 || config.beta <= 0 || config.beta >= 1 ||
+        config.elo1 <= config.elo0) {
+        Tourney_Usage(argv[0]);
+        return 1;
+    }
+
+    printf("%d engines on %dx%d, up to %d games per match, %d threads, seed %llu\n", num_engines, config.rows,
+           config.cols, config.max_games, config.threads, (unsigned long long)config.seed);
+    printf("SPRT elo0 %+.1f elo1 %+.1f alpha %.3f beta %.3f\n", config.elo0, config.elo1, config.alpha,
+           config.beta);
+    for (int i = 0; i < num_engines; i++) {
+        for (int j = i + 1; j < num_engines; j++) {
+            TourneyMatch match;
+            match.config = &config;
+            match.engine[0] = engines[j];
+            match.engine[1] = engines[i];
+            uint64_t start = Timer_NowNs();
+            Tourney_RunMatch(&match);
+            Tourney_Report(&config, &match, Timer_ElapsedMs(start) / 1000.0);
+            fflush(stdout);
+        }
+    }
+
+    if (config.tablebase) Tablebase_Close(&tablebase);
+    if (config.records && !RecordWriter_Close(&records)) {
+        perror("game records");
+        return 1;
+    }
+    return 0;
+}